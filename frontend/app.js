@@ -1,6 +1,8 @@
-async function fetchClock() {
-  const res = await fetch("/clock");
-  const data = await res.json();
+let clockData = null;
+
+function renderClock() {
+  if (!clockData) return;
+  const data = clockData;
 
   const now = new Date();
   const h = now.getHours().toString().padStart(2, "0");
@@ -19,10 +21,7 @@ async function fetchClock() {
 
 
 
-async function fetchWeather() {
-  const res = await fetch("/weather");
-  const data = await res.json();
-
+function renderWeather(data) {
   const today = data.forecast?.[0];
 
   const iconEl = document.getElementById("weather-icon");
@@ -77,10 +76,7 @@ async function fetchWeather() {
   });
 }
 
-async function fetchDepartures() {
-  const res = await fetch("/departures");
-  const data = await res.json();
-
+function renderDepartures(data) {
   const departuresDiv = document.getElementById("departures");
   departuresDiv.innerHTML = "";
 
@@ -94,28 +90,38 @@ async function fetchDepartures() {
     departuresDiv.appendChild(document.createElement("hr"));
 
     group.departures.forEach((dep) => {
+      const parts = [`${dep.from} - ${dep.to}`];
+      if (dep.minutes === 0) parts.push("Avgår nu");
+      else if (dep.minutes > 0) parts.push(`Avgår om ${dep.minutes} min`);
+      if (dep.arrival_minutes >= 0) parts.push(`Ankomsttid ${dep.arrival_minutes} min`);
+      dep.transfers.forEach((t) =>
+        parts.push(`Byt till ${t.line}${t.direction ? ` mot ${t.direction}` : ""}`),
+      );
+      if (dep.delayed) parts.push("Delayed");
+
       const d = document.createElement("div");
       d.className = "departure-line";
-      d.textContent = dep;
-      if (
-        dep.toLowerCase().includes("försenad") ||
-        dep.toLowerCase().includes("delayed")
-      ) {
-        d.classList.add("delayed");
-      }
+      d.textContent = parts.join(" | ");
+      if (dep.delayed) d.classList.add("delayed");
       departuresDiv.appendChild(d);
     });
   });
 }
 
-async function initialize() {
-  await fetchClock();
-  await fetchWeather();
-  await fetchDepartures();
+// The server pushes each section only when it changes and sends the current state of all
+// of them on connect; EventSource reconnects on its own if the stream drops.
+function initialize() {
+  const events = new EventSource("/events");
+
+  events.addEventListener("clock", (e) => {
+    clockData = JSON.parse(e.data);
+    renderClock();
+  });
+  events.addEventListener("weather", (e) => renderWeather(JSON.parse(e.data)));
+  events.addEventListener("departures", (e) => renderDepartures(JSON.parse(e.data)));
 
-  setInterval(fetchClock, 1000);
-  setInterval(fetchWeather, 60000);
-  setInterval(fetchDepartures, 30000);
+  // Seconds tick locally; only the date and week come from the server.
+  setInterval(renderClock, 1000);
 }
 
 initialize();
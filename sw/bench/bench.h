@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// Minimal harness for the smart_mirror_bench target: wall-clock time per operation plus
+// heap usage, tracked by the global operator new/delete replacements in bench_main.cc.
+
+struct AllocationStats {
+    size_t allocations = 0;
+    size_t bytes = 0;
+    size_t peak_bytes = 0; // high-water mark above the level at reset
+};
+
+void reset_allocation_stats();
+AllocationStats allocation_stats();
+
+std::string load_fixture(const std::string& name);
+// sl_trips.json with every timestamp moved so its trips depart in the next few minutes;
+// departures are relative to now, so the recorded times would otherwise have passed.
+std::string sl_fixture();
+
+// Runs fn for at least min_time (after a warm-up call) and prints ns/op, allocations/op
+// and the peak heap growth of a single call.
+void run_benchmark(const std::string& name, const std::function<void()>& fn,
+                   double min_time_seconds = 0.5);
+
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+void run_weather_benchmarks();
+void run_time_benchmarks();
+void run_router_benchmarks();
+void run_transport_benchmarks();
+void run_http_benchmarks();
+void run_load_benchmarks();
@@ -0,0 +1,132 @@
+#include "bench.h"
+#include "helpers/iso_time.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+std::atomic<size_t> allocation_count{0};
+std::atomic<size_t> allocated_bytes{0};
+std::atomic<size_t> live_bytes{0};
+std::atomic<size_t> peak_live_bytes{0};
+std::atomic<size_t> baseline_bytes{0};
+
+// Each block carries its size in a 16-byte header so delete can account for it.
+void* tracked_alloc(size_t size) {
+    void* raw = std::malloc(size + 16);
+    if (!raw)
+        throw std::bad_alloc();
+    *static_cast<size_t*>(raw) = size;
+
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    size_t live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live))
+        ;
+    return static_cast<char*>(raw) + 16;
+}
+
+void tracked_free(void* ptr) {
+    if (!ptr)
+        return;
+    void* raw = static_cast<char*>(ptr) - 16;
+    live_bytes.fetch_sub(*static_cast<size_t*>(raw), std::memory_order_relaxed);
+    std::free(raw);
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    return tracked_alloc(size);
+}
+void* operator new[](size_t size) {
+    return tracked_alloc(size);
+}
+void operator delete(void* ptr) noexcept {
+    tracked_free(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+    tracked_free(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+    tracked_free(ptr);
+}
+void operator delete[](void* ptr, size_t) noexcept {
+    tracked_free(ptr);
+}
+
+void reset_allocation_stats() {
+    allocation_count = 0;
+    allocated_bytes = 0;
+    baseline_bytes = live_bytes.load();
+    peak_live_bytes = live_bytes.load();
+}
+
+AllocationStats allocation_stats() {
+    AllocationStats stats;
+    stats.allocations = allocation_count.load();
+    stats.bytes = allocated_bytes.load();
+    stats.peak_bytes = peak_live_bytes.load() - baseline_bytes.load();
+    return stats;
+}
+
+std::string load_fixture(const std::string& name) {
+    std::ifstream file(std::string(SMART_MIRROR_FIXTURE_DIR) + "/" + name, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("missing fixture: " + name);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+std::string sl_fixture() {
+    constexpr auto recorded_at = parse_iso_datetime("2025-12-20T15:00:00Z").value();
+    auto now = std::chrono::floor<std::chrono::minutes>(std::chrono::system_clock::now());
+    return shift_iso_datetimes(load_fixture("sl_trips.json"), now - recorded_at);
+}
+
+void run_benchmark(const std::string& name, const std::function<void()>& fn,
+                   double min_time_seconds) {
+    reset_allocation_stats();
+    fn();
+    AllocationStats single = allocation_stats();
+
+    using clock = std::chrono::steady_clock;
+    size_t iterations = 0;
+    auto start = clock::now();
+    auto deadline = start + std::chrono::duration<double>(min_time_seconds);
+    reset_allocation_stats();
+    do {
+        fn();
+        ++iterations;
+    } while (clock::now() < deadline);
+    double elapsed_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    AllocationStats total = allocation_stats();
+
+    std::printf("%-44s %10zu it %12.0f ns/op %9.1f allocs/op %10zu B peak\n", name.c_str(),
+                iterations, elapsed_ns / iterations, double(total.allocations) / iterations,
+                single.peak_bytes);
+}
+
+int main() {
+    try {
+        run_weather_benchmarks();
+        run_time_benchmarks();
+        run_router_benchmarks();
+        run_transport_benchmarks();
+        run_http_benchmarks();
+        run_load_benchmarks();
+    } catch (const std::exception& e) {
+        std::cerr << "benchmark failed: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "bench.h"
+#include "http/http_request.h"
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+
+// What a browser sends for the page's polled endpoints.
+const std::string browser_get = "GET /departures HTTP/1.1\r\n"
+                                "Host: mirror.local:8080\r\n"
+                                "Connection: keep-alive\r\n"
+                                "User-Agent: Mozilla/5.0 (X11; Linux aarch64) AppleWebKit/537.36 "
+                                "(KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+                                "Accept: */*\r\n"
+                                "Referer: http://mirror.local:8080/\r\n"
+                                "Accept-Encoding: gzip, deflate\r\n"
+                                "Accept-Language: sv-SE,sv;q=0.9,en;q=0.8\r\n"
+                                "If-None-Match: \"1f3a-9c2e5d7b41a08f63\"\r\n"
+                                "\r\n";
+
+} // namespace
+
+// The parser as handle_client drives it: whole requests, a request split across reads, and
+// a pipelined burst consumed from one buffer.
+void run_http_benchmarks() {
+    HttpRequestParser parser;
+    HttpRequest request;
+    if (parser.parse(browser_get, request) != HttpRequestParser::State::Complete ||
+        request.path != "/departures")
+        throw std::runtime_error("request fixture does not parse");
+
+    run_benchmark("http/parse_request", [&]() {
+        parser.reset();
+        auto state = parser.parse(browser_get, request);
+        do_not_optimize(state);
+    });
+
+    run_benchmark("http/parse_request (3 reads)", [&]() {
+        parser.reset();
+        std::string_view all = browser_get;
+        parser.parse(all.substr(0, 40), request);
+        parser.parse(all.substr(0, 200), request);
+        auto state = parser.parse(all, request);
+        do_not_optimize(state);
+    });
+
+    std::string burst;
+    for (int i = 0; i < 8; ++i)
+        burst += browser_get;
+    run_benchmark("http/parse_request (pipelined x8)", [&]() {
+        std::string_view rest = burst;
+        while (!rest.empty()) {
+            parser.reset();
+            if (parser.parse(rest, request) != HttpRequestParser::State::Complete)
+                break;
+            rest.remove_prefix(parser.consumed());
+        }
+        do_not_optimize(rest);
+    });
+}
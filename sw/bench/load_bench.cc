@@ -0,0 +1,196 @@
+#include "bench.h"
+#include "clock/clock.h"
+#include "helpers/http_client.h"
+#include "helpers/metrics.h"
+#include "http/http_server.h"
+#include "transport/departure_group.h"
+#include "weather/weather.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+using steady = std::chrono::steady_clock;
+
+namespace {
+
+constexpr int load_port = 18080;
+constexpr size_t load_connections = 8; // per reactor, so the clients keep every loop busy
+constexpr auto load_duration = std::chrono::seconds(2);
+
+int connect_local(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+// Reads one response off a keep-alive connection. Returns false if the server closed it
+// first; sets close when the server announced it will.
+bool read_response(int fd, std::string& in, bool& close) {
+    in.clear();
+    size_t header_end = std::string::npos;
+    size_t total = std::string::npos;
+    char buf[16384];
+    while (total == std::string::npos || in.size() < total) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0)
+            return false;
+        in.append(buf, n);
+        if (header_end == std::string::npos) {
+            header_end = in.find("\r\n\r\n");
+            if (header_end == std::string::npos)
+                continue;
+            std::string_view head(in.data(), header_end);
+            size_t length = head.find("Content-Length: ");
+            size_t body = length == std::string_view::npos
+                              ? 0
+                              : std::stoul(std::string(head.substr(length + 16, 20)));
+            total = header_end + 4 + body;
+            close = head.find("Connection: close") != std::string_view::npos;
+        }
+    }
+    return true;
+}
+
+// Closed-loop load: each connection sends its next request as soon as the previous response
+// is in, so the rate is the server's throughput at that concurrency.
+void run_load(const std::string& path, int port, size_t reactors) {
+    const std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    Histogram latency;
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> failed{0};
+    auto start = steady::now();
+    auto deadline = start + load_duration;
+
+    std::vector<std::thread> clients;
+    for (size_t i = 0; i < load_connections * reactors; ++i)
+        clients.emplace_back([&]() {
+            SocketHandler conn(-1); // reconnected whenever the server closes it
+            std::string in;
+            while (steady::now() < deadline) {
+                if (conn.get() < 0)
+                    conn = SocketHandler(connect_local(port));
+                auto sent = steady::now();
+                bool close = false;
+                if (send(conn.get(), request.data(), request.size(), MSG_NOSIGNAL) !=
+                        static_cast<ssize_t>(request.size()) ||
+                    !read_response(conn.get(), in, close)) {
+                    failed.fetch_add(1, std::memory_order_relaxed);
+                    conn = SocketHandler(-1);
+                    continue;
+                }
+                latency.record(steady::now() - sent);
+                completed.fetch_add(1, std::memory_order_relaxed);
+                if (close)
+                    conn = SocketHandler(-1);
+            }
+        });
+    for (auto& client : clients)
+        client.join();
+
+    double seconds = std::chrono::duration<double>(steady::now() - start).count();
+    auto totals = latency.totals();
+    std::string name = "load/GET " + path + " (" + std::to_string(reactors) +
+                       (reactors == 1 ? " reactor)" : " reactors)");
+    std::printf("%-44s %10llu req %10.0f req/s %9.1f us p50 %9.1f us p99 %6llu failed\n",
+                name.c_str(), static_cast<unsigned long long>(completed.load()),
+                completed / seconds, totals.quantile(0.50) / 1e3, totals.quantile(0.99) / 1e3,
+                static_cast<unsigned long long>(failed.load()));
+}
+
+} // namespace
+
+// Serves the fixtures through the real server on a loopback port and drives it with
+// load_connections keep-alive clients per reactor and endpoint, first with a single reactor
+// and then with one per core, to show how throughput scales. Each server runs on a detached
+// thread for the rest of the process; there is no way to stop it.
+void run_load_benchmarks() {
+    static Weather weather;
+    static ClockState clock;
+    static DepartureGroup group("Huvudsta", "Kista");
+    static ResponseCache responses;
+    static StaticAssets assets(SMART_MIRROR_FRONTEND_DIR);
+
+    weather.update_from_json(load_fixture("smhi_forecast.json"));
+    HttpResponse trips;
+    trips.status = 200;
+    trips.body = sl_fixture();
+    group.apply_response(trips);
+    clock.update();
+
+    responses.add("/clock", [] { return clock.version(); }, [] {
+        auto now = clock.snapshot();
+        json j{{"current_date", now->date}, {"current_time", now->time}};
+        return std::make_pair(j.dump(), "application/json");
+    });
+    responses.add("/weather", [] { return weather.version(); }, [] {
+        json days = json::array();
+        for (const auto& d : weather.forecast()->daily)
+            days.push_back({{"min_temp", d.min_temperature},
+                            {"max_temp", d.max_temperature},
+                            {"avg_wind", d.avg_wind_speed},
+                            {"weather_code", d.most_common_weather_code}});
+        return std::make_pair(json{{"forecast", days}}.dump(), "application/json");
+    });
+    responses.add("/departures", [] { return group.version(); }, [] {
+        auto now = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+        json lines = json::array();
+        for (const auto& d : group.upcoming(now, 5))
+            lines.push_back(d.display(now));
+        json j = json::array({{{"name", group.get_name()}, {"departures", lines}}});
+        return std::make_pair(j.dump(), "application/json");
+    });
+    responses.refresh();
+
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> reactor_counts{1};
+    if (cores > 1)
+        reactor_counts.push_back(cores);
+
+    static std::vector<std::unique_ptr<HttpServer>> servers;
+    for (size_t count : reactor_counts) {
+        int port = load_port + static_cast<int>(servers.size());
+        HttpServerOptions options;
+        options.max_keep_alive_requests = 1 << 30;
+        options.reactors = count;
+        auto& server = *servers.emplace_back(std::make_unique<HttpServer>(port, options));
+        server.add_cached(responses);
+        server.add_static(assets);
+        std::thread([&server] { server.start(); }).detach();
+
+        auto give_up = steady::now() + std::chrono::seconds(5);
+        for (;;) {
+            SocketHandler probe(connect_local(port));
+            if (probe.get() >= 0)
+                break;
+            if (steady::now() > give_up)
+                throw std::runtime_error("load server did not start on port " +
+                                         std::to_string(port));
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        for (const char* path : {"/clock", "/weather", "/departures", "/app.js"})
+            run_load(path, port, count);
+    }
+}
@@ -0,0 +1,49 @@
+#include "bench.h"
+#include "http/router.h"
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// The app's own routes plus `extra` generated siblings, to show lookup cost does not
+// depend on how many routes there are.
+Router build_router(size_t extra) {
+    Router router;
+    uint32_t id = 0;
+    for (const char* path : {"/clock", "/weather", "/departures", "/events", "/stats"})
+        router.add("GET", path, id++);
+    router.add("GET", "/departures/{group}", id++);
+    for (size_t i = 0; i < extra; ++i)
+        router.add("GET", "/api/v1/resource" + std::to_string(i) + "/{id}", id++);
+    router.add("GET", "/*", id++);
+    router.freeze();
+    return router;
+}
+
+void bench_lookups(const std::string& name, const Router& router) {
+    const char* paths[] = {"/clock", "/departures/kth", "/icons/wi-fog.svg", "/weather",
+                           "/api/v1/resource7/42"};
+    run_benchmark(name, [&]() {
+        for (const char* path : paths) {
+            Router::Match match;
+            auto result = router.find("GET", path, match);
+            do_not_optimize(result);
+            do_not_optimize(match);
+        }
+    });
+}
+
+} // namespace
+
+void run_router_benchmarks() {
+    Router small = build_router(10);
+    Router large = build_router(1000);
+
+    Router::Match match;
+    if (large.find("GET", "/departures/kth", match) != Router::Result::Found ||
+        match.params.get("group") != "kth")
+        throw std::runtime_error("router does not resolve /departures/{group}");
+
+    bench_lookups("router/find x5 (16 routes)", small);
+    bench_lookups("router/find x5 (1006 routes)", large);
+}
@@ -0,0 +1,53 @@
+#include "bench.h"
+#include "helpers/helper.h"
+#include "helpers/iso_time.h"
+#include <array>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// What parse_minutes, Weather::str_to_time_t and the clock's weekday lookup used to do.
+time_t parse_iostream(const std::string& text) {
+    std::tm tm{};
+    std::istringstream ss(text);
+    ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
+    if (ss.fail())
+        return 0;
+    return timegm(&tm);
+}
+
+const std::array<std::string, 8> samples{
+    "2025-12-20T15:00:00Z", "2025-12-20T16:00:00Z", "2025-12-21T00:00:00Z",
+    "2025-12-24T12:00:00Z", "2026-01-01T06:00:00Z", "2026-02-28T23:00:00Z",
+    "2026-03-29T01:00:00Z", "2026-06-15T18:30:00Z"};
+
+} // namespace
+
+void run_time_benchmarks() {
+    for (const auto& text : samples)
+        if (parse_iostream(text) != parse_iso_datetime(text)->time_since_epoch().count())
+            throw std::runtime_error("ISO parsers disagree on " + text);
+
+    run_benchmark("time/get_time (baseline)", [&]() {
+        for (const auto& text : samples) {
+            time_t t = parse_iostream(text);
+            do_not_optimize(t);
+        }
+    });
+    run_benchmark("time/parse_iso_datetime", [&]() {
+        for (const auto& text : samples) {
+            auto t = parse_iso_datetime(text);
+            do_not_optimize(t);
+        }
+    });
+    run_benchmark("time/parse_minutes", [&]() {
+        for (const auto& text : samples) {
+            int m = parse_minutes(text);
+            do_not_optimize(m);
+        }
+    });
+}
@@ -0,0 +1,44 @@
+#include "bench.h"
+#include "helpers/http_client.h"
+#include "helpers/iso_time.h"
+#include "transport/departure_group.h"
+#include <chrono>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+void run_transport_benchmarks() {
+    const std::string payload = sl_fixture();
+    const json document = json::parse(payload);
+    const json& journeys = document["journeys"];
+
+    auto now = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+    HttpResponse response;
+    response.status = 200;
+    response.body = payload;
+
+    DepartureGroup group("Huvudsta", "Kista");
+    if (!group.apply_response(response) ||
+        group.upcoming(now, 10).size() != journeys.size())
+        throw std::runtime_error("SL fixture does not yield one departure per journey");
+
+    run_benchmark("transport/parse_journey x" + std::to_string(journeys.size()), [&]() {
+        for (const auto& journey : journeys) {
+            Departure d = group.parse_journey(journey);
+            do_not_optimize(d);
+        }
+    });
+
+    Departure departure = group.parse_journey(journeys[1]);
+    run_benchmark("transport/Departure::display", [&]() {
+        std::string text = departure.display(now);
+        do_not_optimize(text);
+    });
+
+    run_benchmark("transport/apply_response", [&]() { group.apply_response(response); });
+    run_benchmark("transport/upcoming(5)", [&]() {
+        auto next = group.upcoming(now, 5);
+        do_not_optimize(next);
+    });
+}
@@ -0,0 +1,120 @@
+#include "bench.h"
+#include "helpers/iso_time.h"
+#include "weather/forecast_parser.h"
+#include "weather/weather.h"
+#include <algorithm>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+namespace {
+
+// The DOM-based parser Weather used before the SAX rewrite, kept here as the baseline.
+Forecast parse_forecast_dom(const std::string& json_data) {
+    Forecast out;
+    json j = json::parse(json_data);
+
+    auto read_hour = [](const json& it) {
+        HourlyForecast hf;
+        hf.valid_time =
+            parse_iso_datetime(it.value("validTime", "")).value_or(std::chrono::sys_seconds{});
+        for (auto& ts : it["parameters"]) {
+            std::string name = ts.value("name", "");
+            if (!ts.contains("values") || !ts["values"].is_array() || ts["values"].empty())
+                continue;
+            auto& v = ts["values"][0];
+            if (name == "t" && v.is_number())
+                hf.temperature = v.get<float>();
+            else if (name == "ws" && v.is_number())
+                hf.wind_speed = v.get<float>();
+            else if (name == "Wsymb2" && v.is_number())
+                hf.weather_code = v.get<int>();
+        }
+        return hf;
+    };
+
+    for (auto& it : j["timeSeries"])
+        out.hourly.push_back(read_hour(it));
+
+    std::map<std::string, std::vector<HourlyForecast>> daily_map;
+    for (auto& it : j["timeSeries"]) {
+        HourlyForecast hf = read_hour(it);
+        daily_map[it.value("validTime", "").substr(0, 10)].push_back(hf);
+    }
+
+    for (auto& [date, hours] : daily_map) {
+        ForecastDay fd;
+        fd.date = parse_iso_date(date).value_or(std::chrono::year_month_day{});
+        float sum_wind = 0.0f;
+        fd.min_temperature = hours.front().temperature;
+        fd.max_temperature = hours.front().temperature;
+        std::map<int, int> weather_count;
+        for (auto& h : hours) {
+            fd.min_temperature = std::min(fd.min_temperature, h.temperature);
+            fd.max_temperature = std::max(fd.max_temperature, h.temperature);
+            sum_wind += h.wind_speed;
+            weather_count[h.weather_code]++;
+        }
+        fd.avg_wind_speed = sum_wind / hours.size();
+        fd.most_common_weather_code =
+            std::max_element(weather_count.begin(), weather_count.end(),
+                             [](const auto& a, const auto& b) { return a.second < b.second; })
+                ->first;
+        out.daily.push_back(fd);
+    }
+    return out;
+}
+
+void check_same(const Forecast& a, const Forecast& b) {
+    bool same = a.hourly.size() == b.hourly.size() && a.daily.size() == b.daily.size();
+    for (size_t i = 0; same && i < a.daily.size(); ++i)
+        same = a.daily[i].date == b.daily[i].date &&
+               a.daily[i].min_temperature == b.daily[i].min_temperature &&
+               a.daily[i].max_temperature == b.daily[i].max_temperature &&
+               a.daily[i].most_common_weather_code == b.daily[i].most_common_weather_code;
+    if (!same)
+        throw std::runtime_error("SAX and DOM forecast parsers disagree");
+}
+
+} // namespace
+
+void run_weather_benchmarks() {
+    const std::string payload = load_fixture("smhi_forecast.json");
+
+    Forecast sax;
+    std::string error;
+    if (!parse_forecast(payload, sax, error))
+        throw std::runtime_error("fixture does not parse: " + error);
+    check_same(sax, parse_forecast_dom(payload));
+
+    run_benchmark("weather/parse_dom (baseline)", [&]() {
+        Forecast f = parse_forecast_dom(payload);
+        do_not_optimize(f);
+    });
+    run_benchmark("weather/parse_sax", [&]() {
+        Forecast f;
+        std::string err;
+        parse_forecast(payload, f, err);
+        do_not_optimize(f);
+    });
+
+    Weather weather;
+    run_benchmark("weather/update_from_json", [&]() { weather.update_from_json(payload); });
+
+    run_benchmark("weather/aggregate_daily", [&]() {
+        auto days = aggregate_daily(sax.hourly);
+        do_not_optimize(days);
+    });
+
+    // Lookups at every hour of the forecast window, as the UI would over a day.
+    auto first = sax.hourly.times().front();
+    auto last = sax.hourly.times().back();
+    run_benchmark("weather/get_current_hour", [&]() {
+        for (auto t = first; t <= last; t += std::chrono::hours(1)) {
+            auto hour = weather.get_current_hour(t);
+            do_not_optimize(hour);
+        }
+    });
+}
@@ -1,9 +1,22 @@
 #pragma once
+#include "helpers/snapshot.h"
+#include <chrono>
 #include <cstdint>
 #include <ctime>
 #include <map>
+#include <memory>
 #include <string>
 
+struct ClockReading {
+    std::string date;
+    std::chrono::year_month_day today{}; // local calendar date
+    std::string day;
+    std::string time;
+    uint8_t week_number = 0;
+
+    bool operator==(const ClockReading&) const = default;
+};
+
 class ClockState {
 public:
     void update();
@@ -14,10 +27,10 @@ public:
     std::string get_current_time() const;
     uint8_t get_week_number() const;
 
+    std::shared_ptr<const ClockReading> snapshot() const;
+    uint64_t version() const;
+
 private:
     static const std::map<int, std::string> week_days;
-    uint8_t week_number;
-    std::string current_day;
-    std::string current_time;
-    std::string current_date;
+    Snapshot<ClockReading> current;
 };
@@ -0,0 +1,59 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Flat binary encoding for the on-disk snapshot cache. Values are stored in host byte order
+// since the file is only ever read back by the machine that wrote it.
+class BinaryWriter {
+public:
+    void u8(uint8_t value);
+    void u32(uint32_t value);
+    void i32(int32_t value);
+    void i64(int64_t value);
+    void f32(float value);
+    void str(std::string_view value);
+
+    const std::string& data() const;
+
+private:
+    std::string out;
+
+    void raw(const void* data, size_t size);
+};
+
+// Every read fails once the input runs short, so a truncated payload is caught by checking
+// the last one.
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view data);
+
+    bool u8(uint8_t& value);
+    bool u32(uint32_t& value);
+    bool i32(int32_t& value);
+    bool i64(int64_t& value);
+    bool f32(float& value);
+    bool str(std::string& value);
+
+    bool done() const;
+
+private:
+    std::string_view in;
+
+    bool raw(void* data, size_t size);
+};
+
+struct CacheRecord {
+    std::chrono::system_clock::time_point saved_at;
+    std::string payload;
+};
+
+// Replaces path in one step: the record goes to a temporary file that is fsynced and then
+// renamed over the old one, so a crash leaves either the previous record or the new one.
+bool save_cache(const std::filesystem::path& path, uint32_t format, std::string_view payload);
+
+// Empty when the file is missing, truncated, or written in another format.
+std::optional<CacheRecord> load_cache(const std::filesystem::path& path, uint32_t format);
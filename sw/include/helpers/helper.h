@@ -2,9 +2,10 @@
 #include <cstddef>
 #include <curl/curl.h>
 #include <string>
+#include <string_view>
 
 size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdata);
 
 std::string http_get(const std::string& url);
 
-int parse_minutes(const std::string& display_str);
+int parse_minutes(std::string_view iso_time);
@@ -0,0 +1,121 @@
+#pragma once
+#include <chrono>
+#include <curl/curl.h>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class HttpClient;
+
+struct HttpResponse {
+    long status = 0;
+    std::string body;
+    std::string error; // curl error text; empty when the transfer completed
+    std::chrono::milliseconds elapsed{0};
+    bool reused_connection = false;
+
+    // Cache validators and freshness as sent by the server.
+    std::string etag;
+    std::string last_modified;
+    std::string cache_control;
+    bool from_cache = false; // answered from a still-fresh max-age without touching the network
+
+    // Where it came from, so a consumer that cannot use the body can reject() it.
+    std::string url;
+    HttpClient* client = nullptr;
+
+    bool ok() const {
+        return error.empty() && status >= 200 && status < 300;
+    }
+    // The caller's previous body is still current; this response carries none.
+    bool not_modified() const {
+        return error.empty() && status == 304;
+    }
+    // The body was unusable: the client forgets the URL's validators, so the next request
+    // fetches it in full instead of being told nothing changed.
+    void reject() const;
+};
+
+// Asynchronous HTTP client driven by one curl_multi event loop thread. Any number of
+// requests can be in flight at once, so N upstream fetches take as long as the slowest.
+// Completion callbacks run on the loop thread and should hand heavy work elsewhere.
+//
+// Easy handles are pooled on the loop thread and all of them use one share object for the
+// DNS cache, TLS sessions and open connections, so only the first request to a host pays
+// for the lookup and handshakes. HTTP/2 is negotiated over TLS and multiplexed when the
+// upstream supports it.
+//
+// revalidate() additionally remembers each URL's ETag, Last-Modified and Cache-Control max-age.
+// While a response is fresh the request is answered locally; after that it is sent with
+// If-None-Match / If-Modified-Since. Either way an unchanged resource comes back as a 304
+// with an empty body and the caller keeps what it has. A caller that could not use the last
+// full body calls reject() on it, since a 304 would otherwise keep pointing at that body.
+class HttpClient {
+public:
+    using Callback = std::function<void(HttpResponse)>;
+
+    static constexpr std::chrono::milliseconds default_timeout{10000};
+
+    HttpClient();
+    ~HttpClient();
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    void fetch(const std::string& url, std::chrono::milliseconds timeout, Callback callback);
+    std::future<HttpResponse> fetch(const std::string& url,
+                                    std::chrono::milliseconds timeout = default_timeout);
+    std::future<HttpResponse> revalidate(const std::string& url,
+                                         std::chrono::milliseconds timeout = default_timeout);
+
+    // Drops the validators remembered for url; applied before the next request is started.
+    void invalidate(const std::string& url);
+
+    static HttpClient& shared();
+
+private:
+    struct Transfer {
+        std::string url;
+        std::chrono::milliseconds timeout;
+        Callback callback;
+        HttpResponse response;
+        std::chrono::steady_clock::time_point started;
+        CURL* easy = nullptr;
+        bool conditional = false;
+        curl_slist* headers = nullptr;
+    };
+
+    struct Validators {
+        std::string etag;
+        std::string last_modified;
+        std::chrono::steady_clock::time_point fresh_until;
+    };
+
+    static constexpr size_t max_idle_handles = 16;
+
+    CURLM* multi;
+    CURLSH* share;
+    std::vector<CURL*> idle_handles; // loop thread only
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Transfer>> submitted;
+    std::vector<std::string> invalidated;
+    bool stopping = false;
+    std::unordered_map<CURL*, std::unique_ptr<Transfer>> active; // loop thread only
+    std::unordered_map<std::string, Validators> validators;      // loop thread only
+    std::thread loop;
+
+    void run();
+    void submit(std::unique_ptr<Transfer> transfer);
+    CURL* acquire_handle();
+    void release_handle(CURL* easy);
+    void begin(std::unique_ptr<Transfer> transfer);
+    void finish(CURL* easy, CURLcode result);
+    bool answer_if_fresh(Transfer& transfer);
+    curl_slist* conditional_headers(const std::string& url) const;
+    void store_validators(const Transfer& transfer);
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Fixed-format ISO-8601 parsing for the timestamps SMHI and SL send: "YYYY-MM-DD" and
+// "YYYY-MM-DDTHH:MM:SS" with optional fractional seconds and an optional "Z" or "+HH:MM"
+// suffix (no suffix means UTC). No locale, streams or allocation, and usable in constant
+// expressions. Anything else, including out-of-range fields, yields nullopt.
+
+namespace iso_time_detail {
+
+constexpr bool digits(std::string_view text, size_t pos, size_t count, int& value) {
+    if (pos + count > text.size())
+        return false;
+    value = 0;
+    for (size_t i = pos; i < pos + count; ++i) {
+        char c = text[i];
+        if (c < '0' || c > '9')
+            return false;
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
+
+} // namespace iso_time_detail
+
+constexpr std::optional<std::chrono::year_month_day> parse_iso_date(std::string_view text) {
+    using iso_time_detail::digits;
+    int y, m, d;
+    if (text.size() < 10 || text[4] != '-' || text[7] != '-' || !digits(text, 0, 4, y) ||
+        !digits(text, 5, 2, m) || !digits(text, 8, 2, d))
+        return std::nullopt;
+
+    std::chrono::year_month_day date{std::chrono::year(y), std::chrono::month(m),
+                                     std::chrono::day(d)};
+    if (!date.ok())
+        return std::nullopt;
+    return date;
+}
+
+constexpr std::optional<std::chrono::sys_seconds> parse_iso_datetime(std::string_view text) {
+    using iso_time_detail::digits;
+    auto date = parse_iso_date(text);
+    int hh, mm, ss;
+    if (!date || text.size() < 19 || (text[10] != 'T' && text[10] != ' ') || text[13] != ':' ||
+        text[16] != ':' || !digits(text, 11, 2, hh) || !digits(text, 14, 2, mm) ||
+        !digits(text, 17, 2, ss) || hh > 23 || mm > 59 || ss > 60)
+        return std::nullopt;
+
+    size_t pos = 19;
+    if (pos < text.size() && text[pos] == '.') {
+        ++pos;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+            ++pos;
+    }
+
+    int offset_minutes = 0;
+    if (pos < text.size() && text[pos] == 'Z') {
+        ++pos;
+    } else if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+        int oh, om;
+        if (pos + 6 > text.size() || text[pos + 3] != ':' || !digits(text, pos + 1, 2, oh) ||
+            !digits(text, pos + 4, 2, om))
+            return std::nullopt;
+        offset_minutes = (text[pos] == '+' ? 1 : -1) * (oh * 60 + om);
+        pos += 6;
+    }
+    if (pos != text.size())
+        return std::nullopt;
+
+    return std::chrono::sys_days(*date) + std::chrono::hours(hh) + std::chrono::minutes(mm) +
+           std::chrono::seconds(ss) - std::chrono::minutes(offset_minutes);
+}
+
+// "YYYY-MM-DD", the form the frontend and SMHI use.
+std::string format_iso_date(std::chrono::year_month_day date);
+// "YYYY-MM-DDTHH:MM:SSZ", the form SL and SMHI send.
+std::string format_iso_datetime(std::chrono::sys_seconds time);
+
+// Moves every quoted "YYYY-MM-DDTHH:MM:SSZ" in a document by the same amount, so recorded
+// upstream responses can be replayed as if they were current.
+std::string shift_iso_datetimes(std::string_view text, std::chrono::seconds by);
@@ -0,0 +1,42 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs refresh jobs on their own cadence, each on its own thread, so a slow upstream for one
+// data source never delays another.
+class RefreshScheduler {
+public:
+    using Task = std::function<void()>;
+
+    RefreshScheduler() = default;
+    ~RefreshScheduler();
+
+    RefreshScheduler(const RefreshScheduler&) = delete;
+    RefreshScheduler& operator=(const RefreshScheduler&) = delete;
+
+    void add_task(std::string name, std::chrono::milliseconds interval, Task task,
+                  bool run_immediately = false);
+    void start();
+    void stop();
+
+private:
+    struct Job {
+        std::string name;
+        std::chrono::milliseconds interval;
+        Task task;
+        bool run_immediately;
+    };
+
+    std::vector<Job> jobs;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable stopped;
+    bool stopping = false;
+
+    void run(const Job& job);
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include "http/transparent_hash.h"
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Collapses concurrent calls for the same key into one: the first caller runs the work and
+// everyone who asks for that key meanwhile waits for and shares its result (or exception).
+// A finished result is also handed out for fresh_for afterwards, so a burst of callers
+// costs one execution however many there are.
+template <typename T>
+class SingleFlight {
+public:
+    explicit SingleFlight(std::chrono::milliseconds fresh_for = {}) : fresh_for(fresh_for) {
+    }
+
+    SingleFlight(const SingleFlight&) = delete;
+    SingleFlight& operator=(const SingleFlight&) = delete;
+
+    void set_fresh_for(std::chrono::milliseconds window) {
+        std::lock_guard lock(mutex);
+        fresh_for = window;
+    }
+
+    T run(std::string_view key, const std::function<T()>& work) {
+        std::unique_lock lock(mutex);
+        auto it = calls.find(key);
+        if (it != calls.end() &&
+            (!it->second.finished ||
+             std::chrono::steady_clock::now() - *it->second.finished < fresh_for)) {
+            auto result = it->second.result;
+            lock.unlock();
+            return result.get();
+        }
+
+        std::promise<T> promise;
+        auto result = promise.get_future().share();
+        calls.insert_or_assign(std::string(key), Call{result, std::nullopt});
+        lock.unlock();
+
+        bool failed = false;
+        try {
+            promise.set_value(work());
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+            failed = true;
+        }
+
+        // Only a finished call is ever replaced, so the entry is still this one. Failures
+        // are not reused; the next caller tries again.
+        lock.lock();
+        it = calls.find(key);
+        if (failed)
+            calls.erase(it);
+        else
+            it->second.finished = std::chrono::steady_clock::now();
+        lock.unlock();
+        return result.get();
+    }
+
+private:
+    struct Call {
+        std::shared_future<T> result;
+        std::optional<std::chrono::steady_clock::time_point> finished; // unset while in flight
+    };
+
+    std::mutex mutex;
+    std::chrono::milliseconds fresh_for;
+    std::unordered_map<std::string, Call, TransparentHash, std::equal_to<>> calls;
+};
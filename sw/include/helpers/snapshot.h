@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Single-writer, many-reader publication of immutable values (RCU style). Readers take a
+// reference-counted pointer to whatever is current and never wait on the writer; an old
+// value lives until its last reader drops it.
+template <typename T>
+class Snapshot {
+public:
+    Snapshot() : current(std::make_shared<const T>()) {
+    }
+
+    std::shared_ptr<const T> load() const {
+        return current.load(std::memory_order_acquire);
+    }
+
+    void publish(T value) {
+        publish(std::make_shared<const T>(std::move(value)));
+    }
+
+    void publish(std::shared_ptr<const T> value) {
+        current.store(std::move(value), std::memory_order_release);
+        published.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                        std::memory_order_relaxed);
+        counter.fetch_add(1, std::memory_order_release);
+    }
+
+    // Bumped after every publish; lets consumers notice a change without comparing values.
+    uint64_t version() const {
+        return counter.load(std::memory_order_acquire);
+    }
+
+    // When the current value was published (or the snapshot created, before any publish).
+    std::chrono::steady_clock::time_point published_at() const {
+        return std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(published.load(std::memory_order_relaxed)));
+    }
+
+private:
+    std::atomic<std::shared_ptr<const T>> current;
+    std::atomic<uint64_t> counter{0};
+    std::atomic<std::chrono::steady_clock::rep> published{
+        std::chrono::steady_clock::now().time_since_epoch().count()};
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class ContentEncoding : uint8_t { Identity, Gzip, Brotli };
+
+// Bodies shorter than this go out as-is: the framing would eat most of the saving.
+constexpr size_t default_compress_min_bytes = 1024;
+
+// The token used in Content-Encoding and Accept-Encoding.
+std::string_view content_coding(ContentEncoding encoding);
+
+// Identity and gzip always are; brotli only when the build found libbrotlienc.
+bool encoding_available(ContentEncoding encoding);
+
+// Text, scripts, JSON and SVG; images and fonts are already compressed.
+bool is_compressible(std::string_view content_type);
+
+// Output of the encoder at its highest setting, or nullopt if the encoding is unavailable or
+// failed. Every caller compresses once per body, so ratio matters more than speed.
+std::optional<std::string> compress(ContentEncoding encoding, std::string_view data);
+
+// Picks the coding with the highest q-value among the offered ones (a bit per encoding),
+// preferring brotli, then gzip, on ties. Codings the header does not name, directly or through
+// "*", are not acceptable; identity is unless refused outright. A missing header means identity.
+ContentEncoding negotiate_encoding(std::string_view accept_encoding, unsigned offered);
+
+constexpr unsigned encoding_bit(ContentEncoding encoding) {
+    return 1u << static_cast<unsigned>(encoding);
+}
+
+// Body in one content coding, with the validator of that representation.
+struct EncodedBody {
+    ContentEncoding encoding = ContentEncoding::Identity;
+    std::string body;
+    std::string etag; // strong validator, quoted
+};
+
+// Every available compressed coding of data that comes out smaller; empty when data is below
+// min_bytes.
+std::vector<EncodedBody> compress_variants(std::string_view data, size_t min_bytes);
+
+// The variant the client prefers, or null when the identity body should be sent. Variant is
+// any type with an `encoding` member.
+template <typename Variant>
+const Variant* negotiate(std::string_view accept_encoding, const std::vector<Variant>& variants) {
+    if (variants.empty() || accept_encoding.empty())
+        return nullptr;
+    unsigned offered = encoding_bit(ContentEncoding::Identity);
+    for (const auto& variant : variants)
+        offered |= encoding_bit(variant.encoding);
+    ContentEncoding chosen = negotiate_encoding(accept_encoding, offered);
+    for (const auto& variant : variants)
+        if (variant.encoding == chosen)
+            return &variant;
+    return nullptr;
+}
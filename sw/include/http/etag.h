@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+constexpr uint64_t fnv_offset = 14695981039346656037ull;
+
+// 64-bit FNV-1a; pass the previous result back in to hash data that arrives in pieces.
+uint64_t fnv1a(uint64_t hash, std::string_view data);
+
+// Quoted strong validator built from the representation's size and content hash.
+std::string strong_etag(size_t size, uint64_t hash);
+std::string strong_etag(std::string_view body);
+
+// If-None-Match uses the weak comparison, so a W/ prefix on either side is ignored.
+bool etag_matches(std::string_view if_none_match, std::string_view etag);
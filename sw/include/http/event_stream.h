@@ -0,0 +1,32 @@
+#pragma once
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Server-Sent Events fan-out. Producers publish from any thread; each event is serialized
+// once into a shared frame that the server queues on every subscriber without copying. The
+// latest frame of each event type is kept so a new subscriber starts from current state.
+class EventStream {
+public:
+    using Frame = std::shared_ptr<const std::string>;
+
+    void publish(std::string_view event, std::string_view data);
+
+    // Frames published since the previous call, oldest first.
+    std::vector<Frame> take();
+    // The most recent frame of every event type.
+    std::vector<Frame> current() const;
+
+    // Called after every publish; the server uses it to wake its event loop.
+    void set_notify(std::function<void()> notify);
+
+private:
+    mutable std::mutex mutex;
+    std::map<std::string, Frame, std::less<>> latest;
+    std::vector<Frame> pending;
+    std::function<void()> notify;
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
+// A parsed request as views into the connection's input buffer. The views stay valid until
+// the connection consumes the request and moves on to the next one.
+struct HttpRequest {
+    static constexpr size_t max_headers = 32;
+
+    std::string_view method;
+    std::string_view target; // as sent: path plus query
+    std::string_view path;
+    std::string_view query; // after '?', without it
+    std::string_view version;
+    std::array<std::pair<std::string_view, std::string_view>, max_headers> headers;
+    size_t header_count = 0;
+    std::string_view body;
+
+    // Picked out while parsing, so the server never searches the header list for them.
+    std::string_view connection;
+    std::string_view accept_encoding;
+    std::string_view if_none_match;
+    size_t content_length = 0;
+
+    std::string_view header(std::string_view name) const;
+};
+
+// Incremental HTTP/1.x request parser over a caller-owned buffer; nothing is copied and
+// nothing is allocated. Feed it the unconsumed input each time more arrives: the request
+// line is checked as soon as it is complete and the header terminator search resumes where
+// the previous call stopped, so bad or oversized requests are rejected without waiting for
+// the rest of them. Chunked request bodies are not supported.
+class HttpRequestParser {
+public:
+    enum class State { Incomplete, Complete, Error };
+    enum class Error { None, BadRequest, HeadersTooLarge, BodyTooLarge, NotImplemented };
+
+    explicit HttpRequestParser(size_t max_header_bytes = 8192, size_t max_body_bytes = 8192);
+
+    State parse(std::string_view data, HttpRequest& request);
+    Error error() const;
+    size_t consumed() const;
+    bool headers_complete() const; // only the body of the current request is outstanding
+    void reset();
+
+    // Status line matching error(), e.g. "431 Request Header Fields Too Large".
+    std::string_view error_status() const;
+
+private:
+    size_t max_header_bytes;
+    size_t max_body_bytes;
+    size_t scanned;
+    size_t line_end; // end of the request line once it has been checked
+    const char* line_origin = nullptr; // where the data started when it was
+    size_t header_end;
+    size_t content_length;
+    Error failure;
+
+    State fail(Error error);
+    bool parse_request_line(std::string_view line, HttpRequest& request);
+    bool parse_headers(std::string_view fields, HttpRequest& request);
+};
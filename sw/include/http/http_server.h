@@ -1,40 +1,207 @@
 #pragma once
+#include "helpers/metrics.h"
+#include "http/event_stream.h"
+#include "http/http_request.h"
+#include "http/output_buffer.h"
+#include "http/response_cache.h"
+#include "http/router.h"
+#include "http/socket_handler.h"
+#include "http/static_assets.h"
+#include "http/timer_wheel.h"
+#include "http/worker_pool.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
-#include <unistd.h>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
-struct SocketHandler {
-public:
-    explicit SocketHandler(int fd) : fd_(fd) {
-    }
-    ~SocketHandler() {
-        if (fd_ >= 0)
-            close(fd_);
-    }
-    int get() const {
-        return fd_;
-    }
+struct HttpServerOptions {
+    // Per-connection deadlines. The header deadline runs from a request's first byte; the
+    // others restart whenever bytes move.
+    std::chrono::seconds keep_alive_timeout{15}; // idle between requests
+    std::chrono::seconds header_timeout{10};     // request line and headers, else 408
+    std::chrono::seconds body_timeout{10};       // between reads of a request body, else 408
+    std::chrono::seconds write_timeout{30};      // between writes of a blocked response
+    int listen_backlog = 4096; // pending connections; the kernel caps it at net.core.somaxconn
+    // Event loops, each with its own SO_REUSEPORT listener so the kernel spreads connections
+    // across them. Pinned reactors run on the process's allowed CPUs in order.
+    size_t reactors = 0; // 0 = one per core
+    bool pin_reactors = true;
+    size_t max_keep_alive_requests = 100;
+    size_t worker_threads = 0; // 0 = one per core
+    size_t worker_queue_capacity = 0; // 0 = 16 per worker
+    std::chrono::seconds retry_after{1};
+    std::chrono::seconds event_heartbeat{15};
+    size_t max_event_backlog = 256 * 1024; // unsent bytes before a slow subscriber is dropped
+    // Request limits; each connection reads into one buffer of their sum.
+    size_t max_header_bytes = 8192; // request line and headers, else 431
+    size_t max_body_bytes = 8192;   // else 413
+    // Reference point for the startup timings the server reports.
+    std::chrono::steady_clock::time_point startup = std::chrono::steady_clock::now();
+};
 
-private:
-    int fd_;
+// Thrown by a route handler to answer 404 rather than 500, e.g. for an unknown parameter.
+struct RouteNotFound : std::runtime_error {
+    using std::runtime_error::runtime_error;
 };
 
 class HttpServer {
 public:
     using Handler = std::function<std::pair<std::string, std::string>()>;
+    using RouteHandler = std::function<std::pair<std::string, std::string>(const RouteParams&)>;
 
-    HttpServer(int port = 8080);
+    HttpServer(int port = 8080, HttpServerOptions options = {});
     ~HttpServer();
 
-    void add_route(const std::string& path, Handler handler);
+    // Registration happens before start(), which freezes the route table; the reactors only
+    // ever read it. Patterns follow
+    // Router: "/departures/{group}", "/icons/*".
+    void add_route(const std::string& path, Handler handler); // GET
+    void add_route(std::string_view method, const std::string& pattern, RouteHandler handler);
+    void add_static(const StaticAssets& assets, std::string_view mount = "/");
+    void add_cached(const ResponseCache& cache);
+    void add_events(const std::string& path, EventStream& stream);
+    // Runs the reactors until the process ends; the calling thread becomes the first one.
     void start();
 
+    const WorkerPool& workers() const;
+    // Milliseconds from options.startup to the first response byte written; -1 until then.
+    int64_t time_to_first_byte() const;
+
 private:
+    struct Reactor;
+
+    // What a connection is waiting on, which decides its deadline.
+    enum class Phase : uint8_t { None, Idle, Header, Body, Write };
+
+    struct Connection {
+        Connection(int fd, const HttpServerOptions& options)
+            : socket(fd),
+              in(std::make_unique_for_overwrite<char[]>(options.max_header_bytes +
+                                                        options.max_body_bytes)),
+              parser(options.max_header_bytes, options.max_body_bytes), deadline(fd) {
+        }
+
+        uint64_t id = 0;
+        Reactor* reactor = nullptr;
+        SocketHandler socket;
+        std::unique_ptr<char[]> in; // input_capacity bytes; released once streaming
+        size_t in_size = 0;
+        size_t in_offset = 0;     // start of the first unconsumed request
+        bool input_paused = false; // buffer full while a handler runs; socket left unread
+        OutputBuffer out;
+        HttpRequestParser parser;
+        HttpRequest request;
+        size_t requests_served = 0;
+        bool close_after_write = false;
+        bool awaiting_handler = false;
+        bool streaming = false; // subscribed to the event stream; no further requests are read
+        bool peer_closed = false; // read hit EOF; close once the buffered requests are answered
+        TimerWheel::Timer deadline;
+        Phase phase = Phase::None;
+        size_t phase_request = 0; // requests_served when the deadline was last set
+        bool moved_bytes = false;  // since the deadline was last updated
+    };
+
+    struct Completion {
+        int fd;
+        uint64_t connection_id;
+        std::string response;
+        bool keep_alive;
+    };
+
+    // One event loop with its own listening socket, epoll set, connections and deadlines.
+    // Nothing here is touched by another reactor; workers and event publishers only hand
+    // over completions and frames under the mutex and write to the eventfd.
+    struct Reactor {
+        size_t index = 0;
+        int cpu = -1; // pinned CPU, or -1
+        SocketHandler listener{-1};
+        SocketHandler epoll{-1};
+        SocketHandler wake;
+        uint64_t next_connection_id = 0;
+        TimerWheel timers; // declared before connections, whose timers unlink from it
+        std::unordered_map<int, std::unique_ptr<Connection>> connections;
+        std::unordered_set<int> subscribers;
+
+        std::mutex inbox_mutex;
+        std::vector<Completion> completions;
+        std::vector<EventStream::Frame> frames;
+
+        Reactor();
+        void wake_up();
+    };
+
     int port_number;
-    bool is_running;
-    std::unordered_map<std::string, Handler> current_routes;
+    HttpServerOptions options;
+    size_t input_capacity;
+    std::atomic<bool> is_running;
+    struct Route {
+        enum class Kind { Handler, Cached, Static, Events };
+
+        Kind kind;
+        RouteHandler handler = {};            // Kind::Handler
+        std::string key = {};                 // Kind::Cached: path in the response cache
+        const StaticAssets* assets = nullptr; // Kind::Static
+
+        // Per-route series, labelled with the route's pattern; filled in by add().
+        Counter* requests = nullptr;
+        Counter* response_bytes = nullptr;
+        Histogram* handler_time = nullptr;
+
+        void observe(std::chrono::steady_clock::time_point start, size_t bytes) const;
+    };
+
+    Router router;
+    std::vector<Route> routes; // indexed by the router's route ids
+    const ResponseCache* response_cache;
+    // Connection header blocks, built once and referenced from every response.
+    std::shared_ptr<const std::string> keep_alive_headers;
+    std::shared_ptr<const std::string> close_headers;
+    std::atomic<int64_t> first_byte_ms{-1};
+    Counter& bytes_sent;
+    Counter& not_found;
+    Counter& method_not_allowed;
+    Counter& overloaded;
+    Counter& malformed;
+    std::array<Counter*, 5> timeouts{}; // indexed by Phase
+
+    EventStream* event_stream;
+    std::mutex event_handoff; // keeps frames in publish order on their way to the reactors
+    std::vector<std::unique_ptr<Reactor>> reactors;
+
+    // Declared last so worker threads are joined before the state they touch goes away.
+    WorkerPool pool;
 
-    void handle_client(int client_socket);
+    bool open_listener(Reactor& reactor);
+    void run(Reactor& reactor);
+    void accept_clients(Reactor& reactor);
+    bool read_client(Connection& conn);
+    void handle_client(Connection& conn);
+    bool flush_client(Connection& conn);
+    void close_client(Reactor& reactor, int client_socket);
+    void update_deadline(Connection& conn);
+    void expire(Reactor& reactor, int client_socket);
+    void add(std::string_view method, const std::string& pattern, Route route);
+    void dispatch(Connection& conn, bool keep_alive);
+    void run_handler(Connection& conn, const Route& route, bool keep_alive);
+    void serve_static(Connection& conn, std::shared_ptr<const StaticAsset> asset, bool keep_alive);
+    void serve_cached(Connection& conn, std::shared_ptr<const CachedResponse> response,
+                      bool keep_alive);
+    void append_connection_headers(Connection& conn, bool keep_alive) const;
+    void subscribe(Connection& conn);
+    void broadcast_events(Reactor& reactor);
+    void broadcast(Reactor& reactor, const EventStream::Frame& frame);
+    void drain_completions(Reactor& reactor);
+    std::string format_response(std::string_view status, std::string_view type,
+                                std::string_view body, bool keep_alive,
+                                std::string_view extra_headers = {}) const;
 };
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+// Pending response bytes for one connection. Memory pieces are written together with
+// writev; file pieces go straight from the page cache with sendfile. Borrowed pieces keep
+// their owner alive instead of copying, so a cached asset costs only its headers per
+// request.
+class OutputBuffer {
+public:
+    enum class Result { Done, WouldBlock, Error };
+
+    void append(std::string data);
+    void append(std::shared_ptr<const void> owner, std::string_view data);
+    void append_file(std::shared_ptr<const void> owner, int file_fd, off_t offset, size_t length);
+
+    Result flush(int socket, size_t& written);
+
+    bool empty() const;
+    size_t pending_bytes() const;
+    void clear();
+
+private:
+    struct Segment {
+        std::string owned;
+        std::shared_ptr<const void> owner;
+        const char* data = nullptr;
+        size_t size = 0;
+        int file_fd = -1;
+        off_t file_offset = 0;
+    };
+
+    std::deque<Segment> segments;
+    size_t pending = 0;
+
+    void consume(size_t bytes);
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include "helpers/snapshot.h"
+#include "http/compression.h"
+#include "http/transparent_hash.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// One rendered version of an endpoint. The status line and headers are serialized up to the
+// connection-specific ones, so the server only has to add Connection before sending.
+// Compressed variants are built alongside, so content negotiation only picks one of them.
+struct CachedResponse {
+    struct Variant {
+        ContentEncoding encoding = ContentEncoding::Identity;
+        std::string etag;
+        std::string head;
+        std::string not_modified;
+        std::string body;
+    };
+
+    uint64_t version = 0; // source version that first produced this body
+    std::string etag;
+    std::string head;         // 200 status line and headers
+    std::string not_modified; // 304 status line and headers
+    std::string body;         // uncompressed, also what the event stream pushes
+    std::vector<Variant> variants;
+};
+
+// Pre-serialized responses for endpoints that only change when a data source publishes.
+// Each entry pairs a version source with a renderer; refresh() re-renders the entries whose
+// source moved, and the server sends the stored bytes verbatim until the next version.
+// Entries are added before the server starts; lookups never block. Bodies of at least
+// compress_min_bytes are also compressed, once per version.
+class ResponseCache {
+public:
+    explicit ResponseCache(size_t compress_min_bytes = default_compress_min_bytes);
+
+    using Renderer = std::function<std::pair<std::string, std::string>()>; // body, type
+    using VersionSource = std::function<uint64_t()>;
+    using Listener = std::function<void(const std::string& path, const CachedResponse&)>;
+
+    void add(const std::string& path, VersionSource version, Renderer render);
+    void refresh();
+
+    // Called from refresh() whenever an entry's bytes actually change.
+    void on_change(Listener listener);
+
+    // Null until the entry has been rendered once.
+    std::shared_ptr<const CachedResponse> find(std::string_view path) const;
+    std::vector<std::string> paths() const;
+
+private:
+    struct Entry {
+        VersionSource version;
+        Renderer render;
+        bool rendered = false;
+        uint64_t rendered_version = 0;
+        Snapshot<CachedResponse> response;
+    };
+
+    size_t compress_min_bytes;
+    std::mutex refresh_mutex;
+    std::unordered_map<std::string, std::unique_ptr<Entry>, TransparentHash, std::equal_to<>>
+        entries;
+    Listener listener;
+};
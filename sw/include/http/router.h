@@ -0,0 +1,74 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Values captured by a route match. They point into the path that was looked up.
+struct RouteParams {
+    static constexpr size_t max_params = 8;
+
+    std::array<std::pair<std::string_view, std::string_view>, max_params> items;
+    size_t count = 0;
+
+    // Empty when the route has no such parameter. A trailing wildcard is named "*".
+    std::string_view get(std::string_view name) const;
+};
+
+// Radix tree over URL paths. Patterns are literal text plus two kinds of placeholder:
+// "{name}" matches one non-empty path segment and "*" (last only) matches the rest of the
+// path, possibly empty. Literal edges win over parameters and parameters over wildcards,
+// backtracking if a more specific branch dead-ends.
+//
+// Routes are added during setup; freeze() then compacts the tree, after which find() walks
+// it without allocating and in time proportional to the path, not the number of routes.
+class Router {
+public:
+    enum class Result { Found, MethodNotAllowed, NotFound };
+
+    struct Match {
+        uint32_t route = 0;
+        RouteParams params;
+        std::string_view allowed; // "GET, POST" for MethodNotAllowed
+    };
+
+    Router();
+
+    // Throws std::invalid_argument on a malformed pattern, a conflicting parameter name or a
+    // duplicate method, and std::logic_error once frozen.
+    void add(std::string_view method, std::string_view pattern, uint32_t route);
+    void freeze();
+    bool frozen() const;
+
+    Result find(std::string_view method, std::string_view path, Match& match) const;
+
+private:
+    enum class Kind : uint8_t { Literal, Param, Wildcard };
+
+    struct Endpoint {
+        std::string method;
+        uint32_t route;
+    };
+
+    struct Node {
+        Kind kind = Kind::Literal;
+        std::string label; // literal text, or the parameter name
+        std::vector<uint32_t> children; // literal children, sorted by first byte once frozen
+        int32_t param_child = -1;
+        int32_t wildcard_child = -1;
+        std::vector<Endpoint> endpoints;
+        std::string allowed;
+    };
+
+    std::vector<Node> nodes;
+    bool is_frozen = false;
+
+    uint32_t insert_literal(uint32_t at, std::string_view text);
+    uint32_t insert_placeholder(uint32_t at, Kind kind, std::string_view name);
+    int32_t literal_child(const Node& node, unsigned char first) const;
+    bool walk(uint32_t at, std::string_view method, std::string_view rest, Match& match,
+              const Node*& path_match) const;
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <unistd.h>
+#include <utility>
+
+struct SocketHandler {
+public:
+    explicit SocketHandler(int fd) : fd_(fd) {
+    }
+    ~SocketHandler() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+    SocketHandler(const SocketHandler&) = delete;
+    SocketHandler& operator=(const SocketHandler&) = delete;
+    SocketHandler(SocketHandler&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {
+    }
+    SocketHandler& operator=(SocketHandler&& other) noexcept {
+        if (this != &other) {
+            if (fd_ >= 0)
+                close(fd_);
+            fd_ = std::exchange(other.fd_, -1);
+        }
+        return *this;
+    }
+
+    int get() const {
+        return fd_;
+    }
+
+private:
+    int fd_;
+};
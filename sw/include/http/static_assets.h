@@ -0,0 +1,60 @@
+#pragma once
+#include "http/compression.h"
+#include "http/socket_handler.h"
+#include "http/transparent_hash.h"
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct StaticAsset {
+    StaticAsset() = default;
+    explicit StaticAsset(int file_fd) : file(file_fd) {
+    }
+
+    std::string body;       // empty when the asset is file-backed
+    SocketHandler file{-1}; // open descriptor for assets above the inline limit
+    size_t size = 0;
+    std::string content_type;
+    std::string etag; // strong validator, quoted
+    std::string cache_control;
+    std::vector<EncodedBody> variants; // compressed copies, always held in memory
+};
+
+// In-memory copy of a directory tree, keyed by URL path ("/app.js", "/icons/wi-fog.svg").
+// Lookups read an immutable snapshot, so a reload never blocks the server. Files larger than
+// inline_limit stay on disk and are served with sendfile instead of being held in memory.
+// Text assets of at least compress_min_bytes are compressed once, when they are loaded.
+class StaticAssets {
+public:
+    explicit StaticAssets(std::filesystem::path root, size_t inline_limit = 32 * 1024,
+                          size_t compress_min_bytes = default_compress_min_bytes);
+    ~StaticAssets();
+
+    StaticAssets(const StaticAssets&) = delete;
+    StaticAssets& operator=(const StaticAssets&) = delete;
+
+    void load();
+    bool watch();
+
+    std::shared_ptr<const StaticAsset> find(std::string_view path) const;
+    size_t size() const;
+    const std::filesystem::path& root_dir() const;
+
+private:
+    using AssetMap = std::unordered_map<std::string, std::shared_ptr<const StaticAsset>,
+                                        TransparentHash, std::equal_to<>>;
+
+    std::filesystem::path root;
+    size_t inline_limit;
+    size_t compress_min_bytes;
+    std::atomic<std::shared_ptr<const AssetMap>> assets;
+    std::atomic<bool> watching{false};
+    std::thread watcher;
+
+    void watch_loop(int inotify_fd);
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Hashed timing wheel for per-connection deadlines. A deadline is rounded up to the next tick
+// and hashed into one of `slots` lists by tick number; deadlines further out than one turn of
+// the wheel share a slot and are passed over until their turn comes. Scheduling, moving and
+// cancelling a timer are O(1) list splices, and advance() only looks at the slots of the
+// ticks that elapsed. Timers are intrusive: the owner embeds one and a timer that is
+// destroyed leaves the wheel by itself. Single-threaded, like the event loop that owns it.
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class Timer {
+    public:
+        explicit Timer(int owner = -1) : owner(owner) {
+        }
+        ~Timer() {
+            cancel();
+        }
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        void cancel();
+        bool armed() const {
+            return next != this;
+        }
+
+        int owner; // tells the expiry callback whose deadline passed, e.g. a socket
+
+    private:
+        friend class TimerWheel;
+        Timer* prev = this;
+        Timer* next = this;
+        uint64_t expires = 0; // tick number
+
+        void link_before(Timer& head);
+    };
+
+    explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds(100), size_t slots = 512,
+                        Clock::time_point origin = Clock::now());
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // (Re)arms timer to fire at the first tick at or after deadline.
+    void schedule(Timer& timer, Clock::time_point deadline);
+
+    // Fires every timer whose tick has passed by now, earliest slot first. Timers are
+    // disarmed before their callback runs, so it may re-arm them or destroy their owners.
+    size_t advance(Clock::time_point now, const std::function<void(Timer&)>& expired);
+
+    Clock::duration tick_length() const;
+
+private:
+    Clock::duration tick;
+    Clock::time_point origin;
+    uint64_t current = 0; // last tick advance() has processed
+    std::vector<Timer> wheel; // list heads, one per slot; size is a power of two
+
+    uint64_t tick_of(Clock::time_point time) const;
+};
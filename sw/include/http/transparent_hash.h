@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Lets string-keyed unordered maps be searched with a string_view without building a
+// temporary std::string. Pair with std::equal_to<>.
+struct TransparentHash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view key) const {
+        return std::hash<std::string_view>{}(key);
+    }
+};
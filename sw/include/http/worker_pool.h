@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of handler threads. Each worker owns a deque; submissions are spread
+// round-robin and idle workers steal from the back of their neighbours' deques. The total
+// number of queued tasks is bounded so callers can shed load instead of piling it up.
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkerPool(size_t threads = 0, size_t capacity = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    bool try_submit(Task task);
+
+    size_t size() const;
+    size_t capacity() const;
+    size_t queue_depth() const;
+    uint64_t rejected() const;
+    uint64_t completed() const;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    size_t max_queued;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<size_t> depth{0};
+    std::atomic<size_t> next_queue{0};
+    std::atomic<uint64_t> rejected_count{0};
+    std::atomic<uint64_t> completed_count{0};
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void run(size_t index);
+    bool pop(size_t index, Task& task);
+};
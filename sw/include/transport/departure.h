@@ -1,29 +1,36 @@
 #pragma once
+#include <chrono>
+#include <optional>
 #include <string>
+#include <vector>
 
-class Departure {
-public:
-    Departure() = default;
-    Departure(const std::string& dest, int mins, const std::string& info, bool del = false);
+struct DepartureTransfer {
+    std::string line;      // "tunnelbanans blå linje 11"
+    std::string direction; // "Akalla"
+};
 
-    std::string display() const;
+// One trip as SL planned it, with its realtime estimates when SL has them. Times are
+// absolute, so a departure stays correct however long ago it was fetched; minutes are
+// worked out against the caller's clock when it is shown.
+struct Departure {
+    std::string from;      // boarding stop, "Huvudsta"
+    std::string to;        // where the first leg goes, "Västra skogen"
+    std::string line;      // first leg
+    std::string direction; // first leg's terminus
+    std::chrono::sys_seconds planned_departure{};
+    std::optional<std::chrono::sys_seconds> estimated_departure;
+    std::optional<std::chrono::sys_seconds> planned_arrival; // at the end of the last leg
+    std::optional<std::chrono::sys_seconds> estimated_arrival;
+    std::vector<DepartureTransfer> transfers;
+    bool delayed = false; // a leg is not realtime monitored
 
-    void set_destination(const std::string& dest);
-    void set_minutes_until(int mins);
-    void set_delayed(bool del);
-    void set_arrival_minutes(int total_time);
-    void set_transfer_info(const std::string& info);
+    std::chrono::sys_seconds departure_time() const; // estimated if known, else planned
+    std::optional<std::chrono::sys_seconds> arrival_time() const;
 
-    int get_minutes_until() const;
-    std::string get_route_summary() const;
-    std::string get_destination_station() const;
+    // Whole minutes from now, rounded down; negative once the time has passed.
+    static int minutes_until(std::chrono::sys_seconds time, std::chrono::sys_seconds now);
 
-private:
-    std::string route_summary;
-    std::string destination_station;
-    std::string destination;
-    int minutes_until;
-    int arrival_minutes;
-    bool delayed;
-    std::string transfer_info;
+    // The single-line Swedish form the page used to be sent:
+    // "Huvudsta - Västra skogen | Avgår om 3 min | Ankomsttid 21 min | Byt till ...".
+    std::string display(std::chrono::sys_seconds now) const;
 };
@@ -1,5 +1,11 @@
 #pragma once
 #include "departure.h"
+#include "helpers/http_client.h"
+#include "helpers/singleflight.h"
+#include "helpers/snapshot.h"
+#include <chrono>
+#include <filesystem>
+#include <future>
 #include <map>
 #include <nlohmann/json.hpp>
 #include <string>
@@ -10,16 +16,38 @@ public:
     DepartureGroup() = default;
     DepartureGroup(const std::string& from_station, const std::string& to_station);
 
-    void update();
-    std::vector<std::string> display(size_t n = 2) const;
+    bool update(HttpClient& client = HttpClient::shared());
+    // Submits the fetch and returns at once; the response is parsed by whoever first waits
+    // on the result, so no thread is tied up while it is in flight.
+    std::shared_future<bool> begin_update(HttpClient& client = HttpClient::shared());
+    // How long a finished refresh is reused by later update() calls; 1 s by default.
+    void set_refresh_window(std::chrono::milliseconds window);
+    bool apply_response(const HttpResponse& response);
+    static bool update_all(const std::vector<DepartureGroup*>& groups,
+                           HttpClient& client = HttpClient::shared());
+
+    // All groups' last good lists in one file. Loading drops trips that have already left.
+    static bool save_all(const std::vector<DepartureGroup*>& groups,
+                         const std::filesystem::path& path);
+    static bool load_all(const std::vector<DepartureGroup*>& groups,
+                         const std::filesystem::path& path);
+    // The next n trips that have not left by now, soonest first.
+    std::vector<Departure> upcoming(std::chrono::sys_seconds now, size_t n) const;
     std::pair<std::string, std::string> get_station_ids() const;
+    // Scheme and host trips are requested from; defaults to SL's journey planner.
+    void set_base_url(std::string url);
     std::string build_url(const std::string& from_id, const std::string& to_id) const;
+    std::string request_url() const;
     Departure parse_journey(const nlohmann::json& journey) const;
     std::string get_name() const;
+    uint64_t version() const;
+    std::chrono::steady_clock::time_point updated_at() const;
 
 private:
     std::string from;
     std::string to;
-    std::vector<Departure> departures;
+    std::string base_url = "https://journeyplanner.integration.sl.se";
+    Snapshot<std::vector<Departure>> departures;
+    SingleFlight<std::shared_future<bool>> refreshes{std::chrono::seconds(1)};
     static const std::map<std::string, std::string> jp_site_ids;
 };
@@ -0,0 +1,14 @@
+#pragma once
+#include "weather/weather.h"
+#include <string>
+#include <string_view>
+
+// Streams an SMHI point forecast through nlohmann's SAX interface in one pass, keeping only
+// validTime, t, ws and Wsymb2 from each time step straight into the hourly columns; no DOM
+// is built. The per-day aggregates are then computed from the columns. Returns false and sets
+// error on malformed input, leaving out untouched.
+bool parse_forecast(std::string_view json_data, Forecast& out, std::string& error);
+
+// The top-level approvedTime of an SMHI document, found without parsing it. SMHI puts it
+// first, so this is a short scan; empty if absent.
+std::string_view peek_approved_time(std::string_view json_data);
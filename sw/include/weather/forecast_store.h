@@ -0,0 +1,76 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct HourlyForecast {
+    std::chrono::sys_seconds valid_time{}; // UTC
+    float temperature;                     // °C
+    float wind_speed;                      // m/s
+    int weather_code;                      // SMHI weather symbol code
+
+    HourlyForecast() : temperature(0.0f), wind_speed(0.0f), weather_code(0) {
+    }
+};
+
+struct ForecastDay {
+    std::chrono::year_month_day date{}; // UTC calendar day of the hours it covers
+    float min_temperature;
+    float max_temperature;
+    float avg_wind_speed;
+    int most_common_weather_code;
+
+    ForecastDay()
+        : min_temperature(0.0f), max_temperature(0.0f), avg_wind_speed(0.0f),
+          most_common_weather_code(0) {
+    }
+};
+
+// Hourly forecast stored column-wise and ordered by time. Range queries are binary searches
+// over the time column, and the per-day aggregation runs over plain contiguous float arrays.
+class HourlySeries {
+public:
+    using Range = std::pair<size_t, size_t>; // [first, last) row indices
+
+    void reserve(size_t n);
+    void push_back(const HourlyForecast& hour);
+    void clear();
+    // Restores time order if the source did not deliver it.
+    void sort();
+
+    size_t size() const;
+    bool empty() const;
+    HourlyForecast at(size_t i) const;
+
+    // First row at or after t.
+    size_t lower_bound(std::chrono::sys_seconds t) const;
+    // Rows in [from, to).
+    Range between(std::chrono::sys_seconds from, std::chrono::sys_seconds to) const;
+    // Up to n rows starting at the first one at or after t.
+    Range next(std::chrono::sys_seconds t, size_t n) const;
+    // Rows whose UTC date is day.
+    Range on(std::chrono::year_month_day day) const;
+
+    const std::vector<std::chrono::sys_seconds>& times() const;
+    const std::vector<float>& temperatures() const;
+    const std::vector<float>& wind_speeds() const;
+    const std::vector<uint8_t>& weather_codes() const;
+
+private:
+    std::vector<std::chrono::sys_seconds> time;
+    std::vector<float> temperature;
+    std::vector<float> wind_speed;
+    std::vector<uint8_t> weather_code;
+};
+
+struct Forecast {
+    std::string approved_time; // SMHI approvedTime; a new value means a new forecast
+    HourlySeries hourly;
+    std::vector<ForecastDay> daily; // ascending by date
+};
+
+// One ForecastDay per UTC date in the series: min/max temperature, mean wind and the most
+// frequent symbol code (lowest code on a tie).
+std::vector<ForecastDay> aggregate_daily(const HourlySeries& hourly);
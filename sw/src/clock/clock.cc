@@ -1,56 +1,97 @@
 #include <clock/clock.h>
+#include <charconv>
 #include <ctime>
-#include <iomanip>
+#include <optional>
 #include <string>
+#include <string_view>
 
 const std::map<int, std::string> ClockState::week_days{{0, "Söndag"}, {1, "Måndag"},  {2, "Tisdag"},
                                                        {3, "Onsdag"}, {4, "Torsdag"}, {5, "Fredag"},
                                                        {6, "Lördag"}};
 
+namespace {
+
+// Y-M-D with one- or two-digit month and day, the shape update() writes; get_time's %m and
+// %d took both, so padded ISO dates and the clock's own date string parse alike.
+std::optional<std::chrono::year_month_day> parse_loose_date(std::string_view text) {
+    const char* pos = text.data();
+    const char* end = pos + text.size();
+    int fields[3];
+    for (int i = 0; i < 3; ++i) {
+        if (i > 0 && (pos == end || *pos++ != '-'))
+            return std::nullopt;
+        auto [next, ec] = std::from_chars(pos, end, fields[i]);
+        if (ec != std::errc() || (i > 0 && next - pos > 2))
+            return std::nullopt;
+        pos = next;
+    }
+    std::chrono::year_month_day date{std::chrono::year(fields[0]),
+                                     std::chrono::month(static_cast<unsigned>(fields[1])),
+                                     std::chrono::day(static_cast<unsigned>(fields[2]))};
+    if (!date.ok())
+        return std::nullopt;
+    return date;
+}
+
+} // namespace
+
 uint8_t ClockState::calculate_week_number(const std::tm& tm) {
     char buf[4];
     std::strftime(buf, sizeof(buf), "%V", &tm);
     return static_cast<uint8_t>(std::stoi(buf));
 }
 
+// Only publishes when a field actually changes, so the version moves once a minute.
 void ClockState::update() {
     std::time_t now = std::time(nullptr);
-    std::tm* local_time = std::localtime(&now);
+    std::tm local_time{};
+    localtime_r(&now, &local_time);
 
-    int current_year = local_time->tm_year + 1900;
-    int current_month = local_time->tm_mon + 1;
-    int current_day_number = local_time->tm_mday;
-    current_date = std::to_string(current_year) + "-" + std::to_string(current_month) + "-" +
+    ClockReading reading;
+    int current_year = local_time.tm_year + 1900;
+    int current_month = local_time.tm_mon + 1;
+    int current_day_number = local_time.tm_mday;
+    reading.date = std::to_string(current_year) + "-" + std::to_string(current_month) + "-" +
                    std::to_string(current_day_number);
+    reading.today = std::chrono::year_month_day{std::chrono::year(current_year),
+                                                std::chrono::month(current_month),
+                                                std::chrono::day(current_day_number)};
+
+    int hour = local_time.tm_hour;
+    int minute = local_time.tm_min;
+    reading.time = std::to_string(hour) + ":" + std::to_string(minute);
 
-    int hour = local_time->tm_hour;
-    int minute = local_time->tm_min;
-    current_time = std::to_string(hour) + ":" + std::to_string(minute);
+    reading.day = week_days.at(local_time.tm_wday);
 
-    current_day = week_days.at(local_time->tm_wday);
+    reading.week_number = calculate_week_number(local_time);
 
-    week_number = calculate_week_number(*local_time);
+    if (*current.load() != reading)
+        current.publish(std::move(reading));
+}
+
+std::shared_ptr<const ClockReading> ClockState::snapshot() const {
+    return current.load();
+}
+
+uint64_t ClockState::version() const {
+    return current.version();
 }
 
 std::string ClockState::get_current_day() const {
-    return current_day;
+    return current.load()->day;
 }
 
 std::string ClockState::get_current_date() const {
-    return current_date;
+    return current.load()->date;
 }
 
 std::string ClockState::get_weekday_from_date(const std::string& date_str) {
-    std::tm tm{};
-    std::istringstream ss(date_str);
-    ss >> std::get_time(&tm, "%Y-%m-%d"); // parse YYYY-MM-DD
-    if (ss.fail())
+    auto date = parse_loose_date(date_str);
+    if (!date)
         return "Unknown";
 
-    std::time_t time = std::mktime(&tm);
-    tm = *std::localtime(&time);
-
-    auto it = week_days.find(tm.tm_wday);
+    std::chrono::weekday weekday{std::chrono::sys_days(*date)};
+    auto it = week_days.find(static_cast<int>(weekday.c_encoding()));
     if (it != week_days.end())
         return it->second;
 
@@ -58,9 +99,9 @@ std::string ClockState::get_weekday_from_date(const std::string& date_str) {
 }
 
 std::string ClockState::get_current_time() const {
-    return current_time;
+    return current.load()->time;
 }
 
 uint8_t ClockState::get_week_number() const {
-    return week_number;
+    return current.load()->week_number;
 }
@@ -0,0 +1,168 @@
+#include "helpers/disk_cache.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint32_t cache_magic = 0x434d5253; // "SRMC"
+
+bool write_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t n = write(fd, data.data(), data.size());
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data.remove_prefix(n);
+    }
+    return true;
+}
+
+} // namespace
+
+void BinaryWriter::raw(const void* data, size_t size) {
+    out.append(static_cast<const char*>(data), size);
+}
+
+void BinaryWriter::u8(uint8_t value) {
+    raw(&value, sizeof(value));
+}
+
+void BinaryWriter::u32(uint32_t value) {
+    raw(&value, sizeof(value));
+}
+
+void BinaryWriter::i32(int32_t value) {
+    raw(&value, sizeof(value));
+}
+
+void BinaryWriter::i64(int64_t value) {
+    raw(&value, sizeof(value));
+}
+
+void BinaryWriter::f32(float value) {
+    raw(&value, sizeof(value));
+}
+
+void BinaryWriter::str(std::string_view value) {
+    u32(static_cast<uint32_t>(value.size()));
+    raw(value.data(), value.size());
+}
+
+const std::string& BinaryWriter::data() const {
+    return out;
+}
+
+BinaryReader::BinaryReader(std::string_view data) : in(data) {
+}
+
+bool BinaryReader::raw(void* data, size_t size) {
+    if (in.size() < size)
+        return false;
+    std::memcpy(data, in.data(), size);
+    in.remove_prefix(size);
+    return true;
+}
+
+bool BinaryReader::u8(uint8_t& value) {
+    return raw(&value, sizeof(value));
+}
+
+bool BinaryReader::u32(uint32_t& value) {
+    return raw(&value, sizeof(value));
+}
+
+bool BinaryReader::i32(int32_t& value) {
+    return raw(&value, sizeof(value));
+}
+
+bool BinaryReader::i64(int64_t& value) {
+    return raw(&value, sizeof(value));
+}
+
+bool BinaryReader::f32(float& value) {
+    return raw(&value, sizeof(value));
+}
+
+bool BinaryReader::str(std::string& value) {
+    uint32_t size;
+    if (!u32(size) || in.size() < size)
+        return false;
+    value.assign(in.data(), size);
+    in.remove_prefix(size);
+    return true;
+}
+
+bool BinaryReader::done() const {
+    return in.empty();
+}
+
+bool save_cache(const fs::path& path, uint32_t format, std::string_view payload) {
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+
+    BinaryWriter header;
+    header.u32(cache_magic);
+    header.u32(format);
+    header.i64(std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count());
+    header.u32(static_cast<uint32_t>(payload.size()));
+
+    fs::path tmp = path;
+    tmp += ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("cache open failed");
+        return false;
+    }
+    bool written = write_all(fd, header.data()) && write_all(fd, payload) && fsync(fd) == 0;
+    close(fd);
+    if (!written || rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Writing cache " << path << " failed: " << std::strerror(errno) << "\n";
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    // The rename itself is only durable once the directory entry is flushed.
+    int dir = open(path.parent_path().empty() ? "." : path.parent_path().c_str(),
+                   O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir >= 0) {
+        fsync(dir);
+        close(dir);
+    }
+    return true;
+}
+
+std::optional<CacheRecord> load_cache(const fs::path& path, uint32_t format) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return std::nullopt;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string contents = buffer.str();
+
+    BinaryReader reader(contents);
+    uint32_t magic, stored_format, size;
+    int64_t saved_at;
+    if (!reader.u32(magic) || !reader.u32(stored_format) || !reader.i64(saved_at) ||
+        !reader.u32(size) || magic != cache_magic || stored_format != format)
+        return std::nullopt;
+
+    constexpr size_t header_size = 20;
+    if (contents.size() != header_size + size)
+        return std::nullopt;
+
+    CacheRecord record;
+    record.saved_at = std::chrono::system_clock::time_point(std::chrono::seconds(saved_at));
+    record.payload = contents.substr(header_size);
+    return record;
+}
@@ -1,8 +1,8 @@
 #include "helpers/helper.h"
+#include "helpers/http_client.h"
+#include "helpers/iso_time.h"
 #include <chrono>
-#include <iomanip>
 #include <iostream>
-#include <sstream>
 #include <string>
 
 size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdata) {
@@ -13,37 +13,19 @@ size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdata) {
 }
 
 std::string http_get(const std::string& url) {
-    CURL* curl = curl_easy_init();
-    std::string response;
-
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-        CURLcode res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << "\n";
-        }
-
-        curl_easy_cleanup(curl);
+    HttpResponse response = HttpClient::shared().fetch(url).get();
+    if (!response.error.empty()) {
+        std::cerr << "HTTP GET " << url << " failed: " << response.error << "\n";
     }
-
-    return response;
+    return response.body;
 }
 
-int parse_minutes(const std::string& iso_time) {
-    std::tm tm = {};
-    std::istringstream ss(iso_time);
-    ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
-    if (ss.fail())
+int parse_minutes(std::string_view iso_time) {
+    auto tp = parse_iso_datetime(iso_time);
+    if (!tp)
         return -1;
 
-    std::time_t tt = timegm(&tm); // UTC
-
-    auto tp = std::chrono::system_clock::from_time_t(tt);
     auto now = std::chrono::system_clock::now();
-
-    auto diff_min = std::chrono::duration_cast<std::chrono::minutes>(tp - now).count();
+    auto diff_min = std::chrono::duration_cast<std::chrono::minutes>(*tp - now).count();
     return static_cast<int>(diff_min);
 }
@@ -0,0 +1,385 @@
+#include "helpers/http_client.h"
+#include "helpers/helper.h"
+#include "helpers/metrics.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <iostream>
+#include <string_view>
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front())))
+        text.remove_prefix(1);
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back())))
+        text.remove_suffix(1);
+    return text;
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return std::tolower(static_cast<unsigned char>(x)) ==
+                      std::tolower(static_cast<unsigned char>(y));
+           });
+}
+
+// Keeps the validator headers of the final response; a redirect's headers are dropped when
+// the next status line arrives.
+size_t header_callback(char* buffer, size_t size, size_t nitems, void* userdata) {
+    size_t total = size * nitems;
+    auto* response = static_cast<HttpResponse*>(userdata);
+    std::string_view line(buffer, total);
+
+    if (line.starts_with("HTTP/")) {
+        response->etag.clear();
+        response->last_modified.clear();
+        response->cache_control.clear();
+        return total;
+    }
+
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos)
+        return total;
+    std::string_view name = line.substr(0, colon);
+    std::string_view value = trim(line.substr(colon + 1));
+    if (iequals(name, "ETag"))
+        response->etag = value;
+    else if (iequals(name, "Last-Modified"))
+        response->last_modified = value;
+    else if (iequals(name, "Cache-Control"))
+        response->cache_control = value;
+    return total;
+}
+
+// Seconds the response may be reused without asking: max-age, 0 for no-cache, -1 for
+// no-store (nothing may be kept at all).
+long freshness_lifetime(std::string_view cache_control) {
+    long lifetime = 0;
+    while (!cache_control.empty()) {
+        size_t comma = cache_control.find(',');
+        std::string_view directive = trim(cache_control.substr(0, comma));
+        if (iequals(directive, "no-store"))
+            return -1;
+        if (iequals(directive, "no-cache"))
+            return 0;
+        if (directive.size() > 8 && iequals(directive.substr(0, 8), "max-age=")) {
+            std::string_view digits = directive.substr(8);
+            std::from_chars(digits.data(), digits.data() + digits.size(), lifetime);
+        }
+        if (comma == std::string_view::npos)
+            break;
+        cache_control.remove_prefix(comma + 1);
+    }
+    return lifetime;
+}
+
+std::string_view host_of(std::string_view url) {
+    size_t scheme = url.find("://");
+    if (scheme != std::string_view::npos)
+        url.remove_prefix(scheme + 3);
+    return url.substr(0, url.find_first_of("/?#"));
+}
+
+// Latency and outcome per upstream host; the status is "error" when no response came back.
+void record_upstream(std::string_view url, const HttpResponse& response,
+                     std::chrono::nanoseconds elapsed) {
+    auto& metrics = Metrics::global();
+    std::string host(host_of(url));
+    metrics
+        .histogram("smart_mirror_upstream_request_seconds", "Upstream fetch latency.",
+                   {{"host", host}})
+        .record(elapsed);
+    std::string status = response.error.empty() ? std::to_string(response.status) : "error";
+    metrics
+        .counter("smart_mirror_upstream_responses_total", "Upstream fetches by outcome.",
+                 {{"host", host}, {"status", status}})
+        .add();
+}
+
+} // namespace
+
+HttpClient::HttpClient() {
+    static std::once_flag curl_init;
+    std::call_once(curl_init, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+    // The share object is only touched from the loop thread, so it needs no lock callbacks.
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+    multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, 16L);
+
+    loop = std::thread(&HttpClient::run, this);
+}
+
+HttpClient::~HttpClient() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    curl_multi_wakeup(multi);
+    loop.join();
+    for (CURL* easy : idle_handles)
+        curl_easy_cleanup(easy);
+    curl_multi_cleanup(multi);
+    curl_share_cleanup(share);
+}
+
+HttpClient& HttpClient::shared() {
+    static HttpClient client;
+    return client;
+}
+
+void HttpClient::fetch(const std::string& url, std::chrono::milliseconds timeout,
+                       Callback callback) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->url = url;
+    transfer->timeout = timeout;
+    transfer->callback = std::move(callback);
+    submit(std::move(transfer));
+}
+
+void HttpResponse::reject() const {
+    if (client && !url.empty())
+        client->invalidate(url);
+}
+
+void HttpClient::invalidate(const std::string& url) {
+    {
+        std::lock_guard lock(mutex);
+        invalidated.push_back(url);
+    }
+    curl_multi_wakeup(multi);
+}
+
+void HttpClient::submit(std::unique_ptr<Transfer> transfer) {
+    {
+        std::lock_guard lock(mutex);
+        submitted.push_back(std::move(transfer));
+    }
+    curl_multi_wakeup(multi);
+}
+
+std::future<HttpResponse> HttpClient::fetch(const std::string& url,
+                                            std::chrono::milliseconds timeout) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    auto future = promise->get_future();
+    fetch(url, timeout,
+          [promise](HttpResponse response) { promise->set_value(std::move(response)); });
+    return future;
+}
+
+std::future<HttpResponse> HttpClient::revalidate(const std::string& url,
+                                                 std::chrono::milliseconds timeout) {
+    auto promise = std::make_shared<std::promise<HttpResponse>>();
+    auto future = promise->get_future();
+
+    auto transfer = std::make_unique<Transfer>();
+    transfer->url = url;
+    transfer->timeout = timeout;
+    transfer->conditional = true;
+    transfer->callback = [promise](HttpResponse response) {
+        promise->set_value(std::move(response));
+    };
+    submit(std::move(transfer));
+    return future;
+}
+
+CURL* HttpClient::acquire_handle() {
+    CURL* easy;
+    if (idle_handles.empty()) {
+        easy = curl_easy_init();
+        if (!easy)
+            return nullptr;
+    } else {
+        easy = idle_handles.back();
+        idle_handles.pop_back();
+        curl_easy_reset(easy); // clears options, keeps caches and live connections
+    }
+
+    curl_easy_setopt(easy, CURLOPT_SHARE, share);
+    curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(easy, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, "");
+    return easy;
+}
+
+void HttpClient::release_handle(CURL* easy) {
+    if (idle_handles.size() < max_idle_handles)
+        idle_handles.push_back(easy);
+    else
+        curl_easy_cleanup(easy);
+}
+
+void HttpClient::begin(std::unique_ptr<Transfer> transfer) {
+    transfer->response.url = transfer->url;
+    transfer->response.client = this;
+    if (transfer->conditional && answer_if_fresh(*transfer))
+        return;
+
+    CURL* easy = acquire_handle();
+    if (!easy) {
+        transfer->response.error = "curl_easy_init failed";
+        transfer->callback(std::move(transfer->response));
+        return;
+    }
+
+    transfer->easy = easy;
+    transfer->started = std::chrono::steady_clock::now();
+    curl_easy_setopt(easy, CURLOPT_URL, transfer->url.c_str());
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, &transfer->response.body);
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, &transfer->response);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, static_cast<long>(transfer->timeout.count()));
+    if (transfer->conditional) {
+        transfer->headers = conditional_headers(transfer->url);
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, transfer->headers);
+    }
+
+    if (curl_multi_add_handle(multi, easy) != CURLM_OK) {
+        release_handle(easy);
+        curl_slist_free_all(transfer->headers);
+        transfer->response.error = "curl_multi_add_handle failed";
+        transfer->callback(std::move(transfer->response));
+        return;
+    }
+    active.emplace(easy, std::move(transfer));
+}
+
+void HttpClient::finish(CURL* easy, CURLcode result) {
+    auto it = active.find(easy);
+    std::unique_ptr<Transfer> transfer = std::move(it->second);
+    active.erase(it);
+
+    long new_connections = 0;
+    curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &transfer->response.status);
+    curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &new_connections);
+    transfer->response.reused_connection = result == CURLE_OK && new_connections == 0;
+    if (result != CURLE_OK && transfer->response.error.empty())
+        transfer->response.error = curl_easy_strerror(result);
+    auto elapsed = std::chrono::steady_clock::now() - transfer->started;
+    transfer->response.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+    record_upstream(transfer->url, transfer->response, elapsed);
+
+    curl_multi_remove_handle(multi, easy);
+    release_handle(easy);
+    curl_slist_free_all(transfer->headers);
+    transfer->headers = nullptr;
+    if (transfer->conditional && result == CURLE_OK)
+        store_validators(*transfer);
+
+    try {
+        transfer->callback(std::move(transfer->response));
+    } catch (const std::exception& e) {
+        std::cerr << "HTTP completion for " << transfer->url << " failed: " << e.what() << "\n";
+    }
+}
+
+bool HttpClient::answer_if_fresh(Transfer& transfer) {
+    auto it = validators.find(transfer.url);
+    if (it == validators.end() || std::chrono::steady_clock::now() >= it->second.fresh_until)
+        return false;
+
+    transfer.response.status = 304;
+    transfer.response.from_cache = true;
+    transfer.response.etag = it->second.etag;
+    transfer.response.last_modified = it->second.last_modified;
+    try {
+        transfer.callback(std::move(transfer.response));
+    } catch (const std::exception& e) {
+        std::cerr << "HTTP completion for " << transfer.url << " failed: " << e.what() << "\n";
+    }
+    return true;
+}
+
+curl_slist* HttpClient::conditional_headers(const std::string& url) const {
+    auto it = validators.find(url);
+    if (it == validators.end())
+        return nullptr;
+
+    curl_slist* headers = nullptr;
+    if (!it->second.etag.empty())
+        headers = curl_slist_append(headers, ("If-None-Match: " + it->second.etag).c_str());
+    if (!it->second.last_modified.empty())
+        headers = curl_slist_append(headers,
+                                    ("If-Modified-Since: " + it->second.last_modified).c_str());
+    return headers;
+}
+
+// A 200 replaces what is known about the URL; a 304 confirms it and may extend its lifetime.
+void HttpClient::store_validators(const Transfer& transfer) {
+    const HttpResponse& response = transfer.response;
+    if (response.status != 200 && response.status != 304)
+        return;
+
+    long lifetime = freshness_lifetime(response.cache_control);
+    if (lifetime < 0) {
+        validators.erase(transfer.url);
+        return;
+    }
+
+    auto fresh_until = std::chrono::steady_clock::now() + std::chrono::seconds(lifetime);
+    if (response.status == 304) {
+        auto it = validators.find(transfer.url);
+        if (it == validators.end())
+            return;
+        if (!response.etag.empty())
+            it->second.etag = response.etag;
+        if (!response.cache_control.empty())
+            it->second.fresh_until = fresh_until;
+        return;
+    }
+
+    if (response.etag.empty() && response.last_modified.empty() && lifetime == 0) {
+        validators.erase(transfer.url);
+        return;
+    }
+    validators[transfer.url] = {response.etag, response.last_modified, fresh_until};
+}
+
+void HttpClient::run() {
+    for (;;) {
+        std::vector<std::unique_ptr<Transfer>> incoming;
+        std::vector<std::string> forget;
+        {
+            std::lock_guard lock(mutex);
+            if (stopping)
+                break;
+            incoming.swap(submitted);
+            forget.swap(invalidated);
+        }
+        for (const auto& url : forget)
+            validators.erase(url);
+        for (auto& transfer : incoming)
+            begin(std::move(transfer));
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued))
+            if (msg->msg == CURLMSG_DONE)
+                finish(msg->easy_handle, msg->data.result);
+
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+    }
+
+    // Fail whatever is still in flight so no caller waits on a future forever.
+    while (!active.empty()) {
+        auto it = active.begin();
+        it->second->response.error = "client shut down";
+        finish(it->first, CURLE_ABORTED_BY_CALLBACK);
+    }
+    for (auto& transfer : submitted) {
+        transfer->response.error = "client shut down";
+        transfer->callback(std::move(transfer->response));
+    }
+}
@@ -0,0 +1,58 @@
+#include "helpers/iso_time.h"
+#include <cstdio>
+
+namespace {
+
+using namespace std::chrono;
+
+static_assert(parse_iso_date("2025-12-20") == 2025y / December / 20);
+static_assert(!parse_iso_date("2025-02-30"));
+static_assert(parse_iso_datetime("1970-01-02T00:00:01Z")->time_since_epoch() == 86401s);
+static_assert(parse_iso_datetime("2025-12-20T15:00:00+01:00") ==
+              sys_days(2025y / December / 20) + 14h);
+static_assert(parse_iso_datetime("2025-12-20T15:00:00.250Z") ==
+              sys_days(2025y / December / 20) + 15h);
+static_assert(!parse_iso_datetime("2025-12-20T24:00:00Z"));
+static_assert(!parse_iso_datetime("2025-12-20T15:00:00Zjunk"));
+
+} // namespace
+
+std::string format_iso_date(std::chrono::year_month_day date) {
+    char buf[16];
+    int n = std::snprintf(buf, sizeof(buf), "%04d-%02u-%02u", int(date.year()),
+                          unsigned(date.month()), unsigned(date.day()));
+    return std::string(buf, n > 0 ? n : 0);
+}
+
+std::string format_iso_datetime(std::chrono::sys_seconds time) {
+    auto days = std::chrono::floor<std::chrono::days>(time);
+    std::chrono::year_month_day date(days);
+    std::chrono::hh_mm_ss clock(time - days);
+    char buf[24];
+    int n = std::snprintf(buf, sizeof(buf), "%04d-%02u-%02uT%02d:%02d:%02dZ", int(date.year()),
+                          unsigned(date.month()), unsigned(date.day()), int(clock.hours().count()),
+                          int(clock.minutes().count()), int(clock.seconds().count()));
+    return std::string(buf, n > 0 ? n : 0);
+}
+
+std::string shift_iso_datetimes(std::string_view text, std::chrono::seconds by) {
+    constexpr size_t stamp_size = 20;
+    std::string out;
+    out.reserve(text.size());
+    size_t copied = 0;
+    for (size_t pos = text.find('"'); pos != std::string_view::npos;
+         pos = text.find('"', pos + 1)) {
+        if (pos + stamp_size + 1 >= text.size() || text[pos + stamp_size + 1] != '"')
+            continue;
+        std::string_view stamp = text.substr(pos + 1, stamp_size);
+        auto time = stamp.back() == 'Z' ? parse_iso_datetime(stamp) : std::nullopt;
+        if (!time)
+            continue;
+        out.append(text, copied, pos + 1 - copied);
+        out += format_iso_datetime(*time + by);
+        copied = pos + 1 + stamp_size;
+        pos = copied;
+    }
+    out.append(text, copied);
+    return out;
+}
@@ -0,0 +1,222 @@
+#include "helpers/metrics.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <sched.h>
+
+namespace metrics_detail {
+
+// Updates land on the shard of the core they run on; on a migration the thread just uses
+// the next core's shard, which is still correct, only momentarily shared.
+size_t shard_index() {
+    int cpu = sched_getcpu();
+    if (cpu < 0) {
+        static std::atomic<size_t> next{0};
+        thread_local size_t fallback = next.fetch_add(1, std::memory_order_relaxed);
+        return fallback % max_shards;
+    }
+    return static_cast<size_t>(cpu) % max_shards;
+}
+
+} // namespace metrics_detail
+
+using metrics_detail::shard_index;
+
+void Counter::add(uint64_t n) {
+    shards[shard_index()].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const {
+    uint64_t sum = 0;
+    for (const auto& shard : shards)
+        sum += shard.value.load(std::memory_order_relaxed);
+    return sum;
+}
+
+size_t Histogram::bucket_of(uint64_t value) {
+    if (value < sub_buckets)
+        return value;
+    int exponent = std::bit_width(value) - 1;
+    if (exponent > max_exponent)
+        return bucket_count - 1;
+    int shift = exponent - sub_bucket_bits;
+    return (shift + 1) * sub_buckets + ((value >> shift) & (sub_buckets - 1));
+}
+
+uint64_t Histogram::bucket_limit(size_t bucket) {
+    if (bucket < sub_buckets)
+        return bucket + 1;
+    int shift = static_cast<int>(bucket / sub_buckets) - 1;
+    uint64_t lower = (sub_buckets + bucket % sub_buckets) << shift;
+    return lower + (uint64_t{1} << shift);
+}
+
+void Histogram::record(std::chrono::nanoseconds elapsed) {
+    record(static_cast<uint64_t>(std::max<int64_t>(elapsed.count(), 0)));
+}
+
+void Histogram::record(uint64_t nanoseconds) {
+    Shard& shard = (*shards)[shard_index()];
+    shard.buckets[bucket_of(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+Histogram::Totals Histogram::totals() const {
+    Totals totals;
+    for (const auto& shard : *shards) {
+        for (size_t i = 0; i < bucket_count; ++i) {
+            uint64_t n = shard.buckets[i].load(std::memory_order_relaxed);
+            totals.buckets[i] += n;
+            totals.count += n;
+        }
+        totals.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return totals;
+}
+
+uint64_t Histogram::Totals::quantile(double q) const {
+    if (count == 0)
+        return 0;
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * count)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucket_count; ++i) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return bucket_limit(i);
+    }
+    return bucket_limit(bucket_count - 1);
+}
+
+Metrics& Metrics::global() {
+    static Metrics metrics;
+    return metrics;
+}
+
+namespace {
+
+std::string render_labels(const MetricLabels& labels) {
+    std::string out;
+    for (const auto& [key, value] : labels) {
+        if (!out.empty())
+            out += ',';
+        out += key;
+        out += "=\"";
+        for (char c : value) {
+            if (c == '\\' || c == '"')
+                out += '\\';
+            if (c == '\n')
+                out += "\\n";
+            else
+                out += c;
+        }
+        out += '"';
+    }
+    return out;
+}
+
+void append_number(std::string& out, double value) {
+    char buf[32];
+    int n = std::snprintf(buf, sizeof(buf), "%.9g", value);
+    out.append(buf, n);
+}
+
+void append_sample(std::string& out, std::string_view name, std::string_view suffix,
+                   std::string_view labels, std::string_view extra, double value) {
+    out += name;
+    out += suffix;
+    if (!labels.empty() || !extra.empty()) {
+        out += '{';
+        out += labels;
+        if (!labels.empty() && !extra.empty())
+            out += ',';
+        out += extra;
+        out += '}';
+    }
+    out += ' ';
+    append_number(out, value);
+    out += '\n';
+}
+
+// Exported bucket bounds: every second power of two from ~1 µs to ~69 s. Each is an exact
+// HDR bucket boundary, so the cumulative counts carry no interpolation error.
+constexpr int first_le_exponent = 10;
+constexpr int last_le_exponent = 36;
+
+} // namespace
+
+Metrics::Series& Metrics::series(std::string_view name, std::string_view help, Type type,
+                                 const MetricLabels& labels) {
+    std::string rendered = render_labels(labels);
+    std::lock_guard lock(mutex);
+    auto it = families.find(name);
+    if (it == families.end())
+        it = families.emplace(std::string(name), Family{type, std::string(help), {}}).first;
+    for (auto& s : it->second.series)
+        if (s->labels == rendered)
+            return *s;
+    auto& s = it->second.series.emplace_back(std::make_unique<Series>());
+    s->labels = std::move(rendered);
+    return *s;
+}
+
+Counter& Metrics::counter(std::string_view name, std::string_view help,
+                          const MetricLabels& labels) {
+    Series& s = series(name, help, Type::Counter, labels);
+    std::lock_guard lock(mutex);
+    if (!s.counter)
+        s.counter = std::make_unique<Counter>();
+    return *s.counter;
+}
+
+Histogram& Metrics::histogram(std::string_view name, std::string_view help,
+                              const MetricLabels& labels) {
+    Series& s = series(name, help, Type::Histogram, labels);
+    std::lock_guard lock(mutex);
+    if (!s.histogram)
+        s.histogram = std::make_unique<Histogram>();
+    return *s.histogram;
+}
+
+void Metrics::gauge(std::string_view name, std::string_view help, const MetricLabels& labels,
+                    std::function<double()> read) {
+    Series& s = series(name, help, Type::Gauge, labels);
+    std::lock_guard lock(mutex);
+    s.gauge = std::move(read);
+}
+
+std::string Metrics::render() const {
+    std::string out;
+    out.reserve(16 * 1024);
+    std::lock_guard lock(mutex);
+    for (const auto& [name, family] : families) {
+        static constexpr const char* type_names[] = {"counter", "histogram", "gauge"};
+        out += "# HELP " + name + ' ' + family.help + '\n';
+        out += "# TYPE " + name + ' ' + type_names[static_cast<int>(family.type)] + '\n';
+
+        for (const auto& s : family.series) {
+            if (s->counter) {
+                append_sample(out, name, "", s->labels, "", s->counter->value());
+            } else if (s->gauge) {
+                append_sample(out, name, "", s->labels, "", s->gauge());
+            } else if (s->histogram) {
+                auto totals = s->histogram->totals();
+                uint64_t cumulative = 0;
+                size_t bucket = 0;
+                for (int e = first_le_exponent; e <= last_le_exponent; e += 2) {
+                    uint64_t bound = uint64_t{1} << e;
+                    while (bucket < Histogram::bucket_count &&
+                           Histogram::bucket_limit(bucket) <= bound)
+                        cumulative += totals.buckets[bucket++];
+                    char le[48];
+                    std::snprintf(le, sizeof(le), "le=\"%.9g\"", bound / 1e9);
+                    append_sample(out, name, "_bucket", s->labels, le, cumulative);
+                }
+                append_sample(out, name, "_bucket", s->labels, "le=\"+Inf\"", totals.count);
+                append_sample(out, name, "_sum", s->labels, "", totals.sum / 1e9);
+                append_sample(out, name, "_count", s->labels, "", totals.count);
+            }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,53 @@
+#include "helpers/scheduler.h"
+#include <iostream>
+
+RefreshScheduler::~RefreshScheduler() {
+    stop();
+}
+
+void RefreshScheduler::add_task(std::string name, std::chrono::milliseconds interval, Task task,
+                                bool run_immediately) {
+    jobs.push_back({std::move(name), interval, std::move(task), run_immediately});
+}
+
+void RefreshScheduler::start() {
+    for (const auto& job : jobs)
+        threads.emplace_back(&RefreshScheduler::run, this, std::cref(job));
+}
+
+void RefreshScheduler::stop() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    stopped.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+    threads.clear();
+}
+
+void RefreshScheduler::run(const Job& job) {
+    // Deadlines advance by whole intervals so a slow run does not make the cadence drift.
+    auto next = std::chrono::steady_clock::now();
+    if (!job.run_immediately)
+        next += job.interval;
+
+    std::unique_lock lock(mutex);
+    for (;;) {
+        if (stopped.wait_until(lock, next, [this] { return stopping; }))
+            return;
+
+        lock.unlock();
+        try {
+            job.task();
+        } catch (const std::exception& e) {
+            std::cerr << "Refresh task " << job.name << " failed: " << e.what() << "\n";
+        }
+        lock.lock();
+
+        auto now = std::chrono::steady_clock::now();
+        next += job.interval;
+        if (next < now)
+            next = now + job.interval;
+    }
+}
@@ -0,0 +1,199 @@
+#include "http/compression.h"
+#include "http/etag.h"
+#include <zlib.h>
+#ifdef SMART_MIRROR_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+namespace {
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+        s.remove_suffix(1);
+    return s;
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i)
+        if ((a[i] | 0x20) != (b[i] | 0x20))
+            return false;
+    return true;
+}
+
+// q-values in thousandths: "0", "0.5", "1.000". Malformed weights count as 1, the same as
+// leaving them out.
+int parse_qvalue(std::string_view params) {
+    while (!params.empty()) {
+        size_t semi = params.find(';');
+        std::string_view param = trim(params.substr(0, semi));
+        if (param.size() >= 2 && (param[0] | 0x20) == 'q' && param[1] == '=') {
+            std::string_view value = param.substr(2);
+            if (value.empty() || (value[0] != '0' && value[0] != '1'))
+                return 1000;
+            int q = (value[0] - '0') * 1000;
+            if (value.size() > 1 && value[1] == '.') {
+                int scale = 100;
+                for (size_t i = 2; i < value.size() && i < 5 && scale > 0; ++i, scale /= 10) {
+                    if (value[i] < '0' || value[i] > '9')
+                        return 1000;
+                    q += (value[i] - '0') * scale;
+                }
+            }
+            return q > 1000 ? 1000 : q;
+        }
+        if (semi == std::string_view::npos)
+            break;
+        params.remove_prefix(semi + 1);
+    }
+    return 1000;
+}
+
+std::optional<std::string> gzip(std::string_view data) {
+    z_stream stream{};
+    // 15 window bits plus 16 selects the gzip wrapper rather than raw zlib.
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) !=
+        Z_OK)
+        return std::nullopt;
+
+    std::string out(deflateBound(&stream, data.size()) + 32, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    int status = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END)
+        return std::nullopt;
+    return out;
+}
+
+#ifdef SMART_MIRROR_HAVE_BROTLI
+std::optional<std::string> brotli(std::string_view data) {
+    size_t size = BrotliEncoderMaxCompressedSize(data.size());
+    if (size == 0)
+        return std::nullopt;
+    std::string out(size, '\0');
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                               data.size(), reinterpret_cast<const uint8_t*>(data.data()), &size,
+                               reinterpret_cast<uint8_t*>(out.data())))
+        return std::nullopt;
+    out.resize(size);
+    return out;
+}
+#endif
+
+} // namespace
+
+std::string_view content_coding(ContentEncoding encoding) {
+    switch (encoding) {
+    case ContentEncoding::Gzip:
+        return "gzip";
+    case ContentEncoding::Brotli:
+        return "br";
+    case ContentEncoding::Identity:
+        break;
+    }
+    return "identity";
+}
+
+bool encoding_available([[maybe_unused]] ContentEncoding encoding) {
+#ifdef SMART_MIRROR_HAVE_BROTLI
+    return true;
+#else
+    return encoding != ContentEncoding::Brotli;
+#endif
+}
+
+bool is_compressible(std::string_view content_type) {
+    if (content_type.starts_with("text/"))
+        return true;
+    for (std::string_view subtype : {"javascript", "json", "xml"})
+        if (content_type.find(subtype) != std::string_view::npos)
+            return true;
+    return false;
+}
+
+std::optional<std::string> compress(ContentEncoding encoding, std::string_view data) {
+    switch (encoding) {
+    case ContentEncoding::Gzip:
+        return gzip(data);
+    case ContentEncoding::Brotli:
+#ifdef SMART_MIRROR_HAVE_BROTLI
+        return brotli(data);
+#else
+        return std::nullopt;
+#endif
+    case ContentEncoding::Identity:
+        break;
+    }
+    return std::string(data);
+}
+
+ContentEncoding negotiate_encoding(std::string_view accept_encoding, unsigned offered) {
+    constexpr int unlisted = -1;
+    int q[3] = {unlisted, unlisted, unlisted}; // indexed by ContentEncoding
+    int wildcard = unlisted;
+
+    while (!accept_encoding.empty()) {
+        size_t comma = accept_encoding.find(',');
+        std::string_view item = accept_encoding.substr(0, comma);
+        size_t semi = item.find(';');
+        std::string_view name = trim(item.substr(0, semi));
+        int weight = semi == std::string_view::npos ? 1000 : parse_qvalue(item.substr(semi + 1));
+
+        if (iequals(name, "br"))
+            q[static_cast<int>(ContentEncoding::Brotli)] = weight;
+        else if (iequals(name, "gzip") || iequals(name, "x-gzip"))
+            q[static_cast<int>(ContentEncoding::Gzip)] = weight;
+        else if (iequals(name, "identity"))
+            q[static_cast<int>(ContentEncoding::Identity)] = weight;
+        else if (name == "*")
+            wildcard = weight;
+
+        if (comma == std::string_view::npos)
+            break;
+        accept_encoding.remove_prefix(comma + 1);
+    }
+
+    auto best = ContentEncoding::Identity;
+    int best_q = 0;
+    for (auto encoding :
+         {ContentEncoding::Brotli, ContentEncoding::Gzip, ContentEncoding::Identity}) {
+        if (!(offered & encoding_bit(encoding)))
+            continue;
+        int weight = q[static_cast<int>(encoding)];
+        if (weight == unlisted)
+            weight = wildcard != unlisted ? wildcard
+                     : encoding == ContentEncoding::Identity ? 1 // acceptable, least preferred
+                                                            : 0;
+        if (weight > best_q) {
+            best = encoding;
+            best_q = weight;
+        }
+    }
+    return best;
+}
+
+std::vector<EncodedBody> compress_variants(std::string_view data, size_t min_bytes) {
+    std::vector<EncodedBody> variants;
+    if (data.size() < min_bytes)
+        return variants;
+    for (auto encoding : {ContentEncoding::Brotli, ContentEncoding::Gzip}) {
+        if (!encoding_available(encoding))
+            continue;
+        auto body = compress(encoding, data);
+        if (!body || body->size() >= data.size())
+            continue;
+        EncodedBody variant;
+        variant.encoding = encoding;
+        variant.etag = strong_etag(*body);
+        variant.body = std::move(*body);
+        variants.push_back(std::move(variant));
+    }
+    return variants;
+}
@@ -0,0 +1,40 @@
+#include "http/etag.h"
+#include <cstdio>
+
+uint64_t fnv1a(uint64_t hash, std::string_view data) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string strong_etag(size_t size, uint64_t hash) {
+    char buf[40];
+    std::snprintf(buf, sizeof(buf), "\"%zx-%016llx\"", size,
+                  static_cast<unsigned long long>(hash));
+    return buf;
+}
+
+std::string strong_etag(std::string_view body) {
+    return strong_etag(body.size(), fnv1a(fnv_offset, body));
+}
+
+bool etag_matches(std::string_view if_none_match, std::string_view etag) {
+    while (!if_none_match.empty()) {
+        size_t comma = if_none_match.find(',');
+        std::string_view item = if_none_match.substr(0, comma);
+        while (!item.empty() && item.front() == ' ')
+            item.remove_prefix(1);
+        while (!item.empty() && item.back() == ' ')
+            item.remove_suffix(1);
+        if (item.starts_with("W/"))
+            item.remove_prefix(2);
+        if (item == "*" || item == etag)
+            return true;
+        if (comma == std::string_view::npos)
+            break;
+        if_none_match.remove_prefix(comma + 1);
+    }
+    return false;
+}
@@ -0,0 +1,56 @@
+#include "http/event_stream.h"
+
+void EventStream::publish(std::string_view event, std::string_view data) {
+    std::string frame = "event: ";
+    frame += event;
+    frame += '\n';
+    // Every line of a multi-line payload needs its own data: field.
+    for (;;) {
+        size_t newline = data.find('\n');
+        frame += "data: ";
+        frame += data.substr(0, newline);
+        frame += '\n';
+        if (newline == std::string_view::npos)
+            break;
+        data.remove_prefix(newline + 1);
+    }
+    frame += '\n';
+
+    auto shared = std::make_shared<const std::string>(std::move(frame));
+    std::function<void()> wake;
+    {
+        std::lock_guard lock(mutex);
+        auto it = latest.find(event);
+        if (it == latest.end())
+            latest.emplace(std::string(event), shared);
+        else
+            it->second = shared;
+        // Nobody drains the queue until a server has attached.
+        if (notify)
+            pending.push_back(std::move(shared));
+        wake = notify;
+    }
+    if (wake)
+        wake();
+}
+
+std::vector<EventStream::Frame> EventStream::take() {
+    std::vector<Frame> frames;
+    std::lock_guard lock(mutex);
+    frames.swap(pending);
+    return frames;
+}
+
+std::vector<EventStream::Frame> EventStream::current() const {
+    std::vector<Frame> frames;
+    std::lock_guard lock(mutex);
+    frames.reserve(latest.size());
+    for (const auto& [event, frame] : latest)
+        frames.push_back(frame);
+    return frames;
+}
+
+void EventStream::set_notify(std::function<void()> callback) {
+    std::lock_guard lock(mutex);
+    notify = std::move(callback);
+}
@@ -0,0 +1,235 @@
+#include "http/http_request.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+
+namespace {
+
+bool iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return std::tolower(static_cast<unsigned char>(x)) ==
+                      std::tolower(static_cast<unsigned char>(y));
+           });
+}
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+        s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+        s.remove_suffix(1);
+    return s;
+}
+
+// RFC 9110 token characters, as used in methods and field names.
+constexpr auto token_chars = [] {
+    std::array<bool, 256> table{};
+    for (int c = '0'; c <= '9'; ++c)
+        table[c] = true;
+    for (int c = 'a'; c <= 'z'; ++c)
+        table[c] = table[c - 'a' + 'A'] = true;
+    for (char c : std::string_view("!#$%&'*+-.^_`|~"))
+        table[static_cast<unsigned char>(c)] = true;
+    return table;
+}();
+
+bool is_token(std::string_view s) {
+    return !s.empty() && std::all_of(s.begin(), s.end(), [](char c) {
+        return token_chars[static_cast<unsigned char>(c)];
+    });
+}
+
+// Case-insensitive match of a field name against a lowercase name. Token characters other
+// than letters already have the 0x20 bit set, so folding it in is enough.
+bool is_field(std::string_view name, std::string_view lowercase) {
+    if (name.size() != lowercase.size())
+        return false;
+    for (size_t i = 0; i < name.size(); ++i)
+        if ((name[i] | 0x20) != lowercase[i])
+            return false;
+    return true;
+}
+
+bool is_target(std::string_view s) {
+    return !s.empty() && (s.front() == '/' || s == "*") &&
+           std::none_of(s.begin(), s.end(), [](char c) {
+               return static_cast<unsigned char>(c) <= ' ' || c == 0x7f;
+           });
+}
+
+} // namespace
+
+std::string_view HttpRequest::header(std::string_view name) const {
+    for (size_t i = 0; i < header_count; ++i)
+        if (iequals(headers[i].first, name))
+            return headers[i].second;
+    return {};
+}
+
+HttpRequestParser::HttpRequestParser(size_t max_header_bytes, size_t max_body_bytes)
+    : max_header_bytes(max_header_bytes), max_body_bytes(max_body_bytes), scanned(0),
+      line_end(0), header_end(0), content_length(0), failure(Error::None) {
+}
+
+void HttpRequestParser::reset() {
+    scanned = 0;
+    line_end = 0;
+    header_end = 0;
+    content_length = 0;
+    failure = Error::None;
+}
+
+size_t HttpRequestParser::consumed() const {
+    return header_end + content_length;
+}
+
+bool HttpRequestParser::headers_complete() const {
+    return header_end != 0;
+}
+
+HttpRequestParser::Error HttpRequestParser::error() const {
+    return failure;
+}
+
+std::string_view HttpRequestParser::error_status() const {
+    switch (failure) {
+    case Error::HeadersTooLarge:
+        return "431 Request Header Fields Too Large";
+    case Error::BodyTooLarge:
+        return "413 Content Too Large";
+    case Error::NotImplemented:
+        return "501 Not Implemented";
+    case Error::BadRequest:
+    case Error::None:
+        break;
+    }
+    return "400 Bad Request";
+}
+
+HttpRequestParser::State HttpRequestParser::fail(Error error) {
+    failure = error;
+    return State::Error;
+}
+
+HttpRequestParser::State HttpRequestParser::parse(std::string_view data, HttpRequest& request) {
+    if (header_end == 0) {
+        if (line_end == 0) {
+            size_t pos = data.find("\r\n");
+            if (pos == std::string_view::npos) {
+                scanned = data.size();
+                return data.size() > max_header_bytes ? fail(Error::HeadersTooLarge)
+                                                      : State::Incomplete;
+            }
+            request = HttpRequest{};
+            if (!parse_request_line(data.substr(0, pos), request))
+                return fail(Error::BadRequest);
+            line_end = pos;
+            line_origin = data.data();
+            scanned = pos;
+        }
+
+        size_t start = scanned > 3 ? scanned - 3 : 0;
+        size_t pos = data.find("\r\n\r\n", start);
+        if (pos == std::string_view::npos) {
+            scanned = data.size();
+            return data.size() > max_header_bytes ? fail(Error::HeadersTooLarge)
+                                                  : State::Incomplete;
+        }
+        if (pos + 4 > max_header_bytes)
+            return fail(Error::HeadersTooLarge);
+
+        // If the buffer was compacted since the request line was checked, its views point
+        // at the old position and are taken again.
+        if (data.data() != line_origin) {
+            request = HttpRequest{};
+            parse_request_line(data.substr(0, line_end), request);
+            line_origin = data.data();
+        }
+        if (pos > line_end && !parse_headers(data.substr(line_end + 2, pos - line_end), request))
+            return State::Error;
+        header_end = pos + 4;
+        content_length = request.content_length;
+        if (content_length > max_body_bytes)
+            return fail(Error::BodyTooLarge);
+    } else if (data.data() != line_origin) {
+        // Compacted while the body was still arriving: every view into the head is stale.
+        // Both parts were validated the first time, so they are only sliced again.
+        request = HttpRequest{};
+        parse_request_line(data.substr(0, line_end), request);
+        if (header_end - 4 > line_end)
+            parse_headers(data.substr(line_end + 2, header_end - 4 - line_end), request);
+        line_origin = data.data();
+    }
+
+    if (data.size() < header_end + content_length)
+        return State::Incomplete;
+
+    request.body = data.substr(header_end, content_length);
+    return State::Complete;
+}
+
+bool HttpRequestParser::parse_request_line(std::string_view line, HttpRequest& request) {
+    size_t sp1 = line.find(' ');
+    size_t sp2 = line.rfind(' ');
+    if (sp1 == std::string_view::npos || sp2 == sp1)
+        return false;
+
+    request.method = line.substr(0, sp1);
+    request.target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    request.version = line.substr(sp2 + 1);
+    if (!is_token(request.method) || !is_target(request.target) ||
+        (request.version != "HTTP/1.1" && request.version != "HTTP/1.0"))
+        return false;
+
+    size_t q = request.target.find('?');
+    request.path = request.target.substr(0, q);
+    if (q != std::string_view::npos)
+        request.query = request.target.substr(q + 1);
+    return true;
+}
+
+// fields runs from the first header line to just past the last one's CRLF.
+bool HttpRequestParser::parse_headers(std::string_view fields, HttpRequest& request) {
+    bool has_length = false;
+    while (!fields.empty()) {
+        size_t eol = fields.find("\r\n");
+        std::string_view field = fields.substr(0, eol);
+        fields.remove_prefix(eol == std::string_view::npos ? fields.size() : eol + 2);
+
+        // No whitespace before the colon and no obsolete line folding (RFC 9112 5).
+        size_t colon = field.find(':');
+        if (colon == std::string_view::npos || !is_token(field.substr(0, colon))) {
+            fail(Error::BadRequest);
+            return false;
+        }
+        if (request.header_count == HttpRequest::max_headers) {
+            fail(Error::HeadersTooLarge);
+            return false;
+        }
+        std::string_view name = field.substr(0, colon);
+        std::string_view value = trim(field.substr(colon + 1));
+        request.headers[request.header_count++] = {name, value};
+
+        if (is_field(name, "connection")) {
+            request.connection = value;
+        } else if (is_field(name, "accept-encoding")) {
+            request.accept_encoding = value;
+        } else if (is_field(name, "if-none-match")) {
+            request.if_none_match = value;
+        } else if (is_field(name, "transfer-encoding")) {
+            fail(Error::NotImplemented);
+            return false;
+        } else if (is_field(name, "content-length")) {
+            size_t length = 0;
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+            if (ec != std::errc() || ptr != value.data() + value.size() || value.empty() ||
+                (has_length && length != request.content_length)) {
+                fail(Error::BadRequest);
+                return false;
+            }
+            request.content_length = length;
+            has_length = true;
+        }
+    }
+    return true;
+}
@@ -1,30 +1,196 @@
 #include "http/http_server.h"
+#include "http/compression.h"
+#include "http/etag.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sstream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <thread>
 #include <unistd.h>
 
-HttpServer::HttpServer(int port) : port_number(port), is_running(false) {
+namespace {
+
+bool has_token(std::string_view value, std::string_view token) {
+    while (!value.empty()) {
+        size_t comma = value.find(',');
+        std::string_view item = value.substr(0, comma);
+        while (!item.empty() && item.front() == ' ')
+            item.remove_prefix(1);
+        while (!item.empty() && item.back() == ' ')
+            item.remove_suffix(1);
+        if (item.size() == token.size() &&
+            std::equal(item.begin(), item.end(), token.begin(), [](char a, char b) {
+                return std::tolower(static_cast<unsigned char>(a)) == b;
+            }))
+            return true;
+        if (comma == std::string_view::npos)
+            break;
+        value.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+const EventStream::Frame heartbeat_frame = std::make_shared<const std::string>(": ping\n\n");
+
+bool wants_keep_alive(const HttpRequest& request) {
+    std::string_view connection = request.connection;
+    if (request.version == "HTTP/1.0")
+        return has_token(connection, "keep-alive");
+    return !has_token(connection, "close");
+}
+
+} // namespace
+
+HttpServer::HttpServer(int port, HttpServerOptions options)
+    : port_number(port), options(options),
+      input_capacity(options.max_header_bytes + options.max_body_bytes), is_running(false),
+      response_cache(nullptr),
+      keep_alive_headers(std::make_shared<const std::string>(
+          "Connection: keep-alive\r\nKeep-Alive: timeout=" +
+          std::to_string(options.keep_alive_timeout.count()) +
+          ", max=" + std::to_string(options.max_keep_alive_requests) + "\r\n\r\n")),
+      close_headers(std::make_shared<const std::string>("Connection: close\r\n\r\n")),
+      bytes_sent(Metrics::global().counter("smart_mirror_http_sent_bytes_total",
+                                           "Bytes written to client sockets.")),
+      not_found(Metrics::global().counter("smart_mirror_http_unserved_total",
+                                          "Requests answered without reaching a route.",
+                                          {{"reason", "not_found"}})),
+      method_not_allowed(Metrics::global().counter("smart_mirror_http_unserved_total",
+                                                   "Requests answered without reaching a route.",
+                                                   {{"reason", "method_not_allowed"}})),
+      overloaded(Metrics::global().counter("smart_mirror_http_unserved_total",
+                                           "Requests answered without reaching a route.",
+                                           {{"reason", "overloaded"}})),
+      malformed(Metrics::global().counter("smart_mirror_http_unserved_total",
+                                          "Requests answered without reaching a route.",
+                                          {{"reason", "malformed"}})),
+      event_stream(nullptr),
+      pool(options.worker_threads, options.worker_queue_capacity) {
+    for (auto [phase, name] : {std::pair{Phase::Idle, "idle"}, std::pair{Phase::Header, "header"},
+                               std::pair{Phase::Body, "body"}, std::pair{Phase::Write, "write"}})
+        timeouts[static_cast<size_t>(phase)] =
+            &Metrics::global().counter("smart_mirror_http_timeouts_total",
+                                       "Connections closed by a missed deadline.",
+                                       {{"phase", name}});
+
+    size_t count = options.reactors;
+    if (count == 0)
+        count = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < count; ++i) {
+        reactors.push_back(std::make_unique<Reactor>());
+        reactors.back()->index = i;
+    }
+}
+
+HttpServer::Reactor::Reactor() : wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+}
+
+void HttpServer::Reactor::wake_up() {
+    uint64_t one = 1;
+    (void)!write(wake.get(), &one, sizeof(one));
 }
 HttpServer::~HttpServer() {
+    if (event_stream)
+        event_stream->set_notify(nullptr);
 }
 
-void HttpServer::add_route(const std::string& path, Handler handler) {
-    std::string clean = path;
-    if (!clean.empty() && clean.back() == '/')
+void HttpServer::add(std::string_view method, const std::string& pattern, Route route) {
+    std::string clean = pattern;
+    if (clean.size() > 1 && clean.back() == '/')
         clean.pop_back();
-    current_routes[clean] = handler;
+    router.add(method, clean, static_cast<uint32_t>(routes.size()));
+
+    auto& metrics = Metrics::global();
+    MetricLabels labels{{"method", std::string(method)}, {"route", clean}};
+    route.requests = &metrics.counter("smart_mirror_http_requests_total",
+                                      "Requests served per route.", labels);
+    route.response_bytes = &metrics.counter("smart_mirror_http_response_bytes_total",
+                                            "Response bytes queued per route.", labels);
+    route.handler_time = &metrics.histogram("smart_mirror_http_handler_seconds",
+                                            "Time to produce a response per route.", labels);
+    routes.push_back(std::move(route));
 }
 
-void HttpServer::start() {
-    SocketHandler server_fd(socket(AF_INET, SOCK_STREAM, 0));
-    if (server_fd.get() < 0) {
+void HttpServer::Route::observe(std::chrono::steady_clock::time_point start,
+                                size_t bytes) const {
+    handler_time->record(std::chrono::steady_clock::now() - start);
+    requests->add();
+    response_bytes->add(bytes);
+}
+
+void HttpServer::add_route(const std::string& path, Handler handler) {
+    add("GET", path,
+        {.kind = Route::Kind::Handler,
+         .handler = [handler = std::move(handler)](const RouteParams&) { return handler(); }});
+}
+
+void HttpServer::add_route(std::string_view method, const std::string& pattern,
+                           RouteHandler handler) {
+    add(method, pattern, {.kind = Route::Kind::Handler, .handler = std::move(handler)});
+}
+
+// The mount's wildcard maps "/icons/wi-fog.svg" under "/" to the asset "/icons/wi-fog.svg".
+void HttpServer::add_static(const StaticAssets& assets, std::string_view mount) {
+    std::string pattern(mount);
+    if (pattern.empty() || pattern.back() != '/')
+        pattern += '/';
+    add("GET", pattern + "*", {.kind = Route::Kind::Static, .assets = &assets});
+}
+
+void HttpServer::add_cached(const ResponseCache& cache) {
+    response_cache = &cache;
+    for (const auto& path : cache.paths())
+        add("GET", path, {.kind = Route::Kind::Cached, .key = path});
+}
+
+void HttpServer::add_events(const std::string& path, EventStream& stream) {
+    add("GET", path, {.kind = Route::Kind::Events});
+    event_stream = &stream;
+    // Frames are taken on the publishing thread and handed to every reactor, since each one
+    // has subscribers of its own. Taking and handing over happen under one lock; otherwise
+    // two publishers could deliver in the opposite order and leave subscribers on the older
+    // state of an event.
+    event_stream->set_notify([this]() {
+        std::lock_guard handoff(event_handoff);
+        auto frames = event_stream->take();
+        if (frames.empty())
+            return;
+        for (auto& reactor : reactors) {
+            {
+                std::lock_guard lock(reactor->inbox_mutex);
+                reactor->frames.insert(reactor->frames.end(), frames.begin(), frames.end());
+            }
+            reactor->wake_up();
+        }
+    });
+}
+
+const WorkerPool& HttpServer::workers() const {
+    return pool;
+}
+
+int64_t HttpServer::time_to_first_byte() const {
+    return first_byte_ms.load(std::memory_order_relaxed);
+}
+
+bool HttpServer::open_listener(Reactor& reactor) {
+    SocketHandler listener(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+    if (listener.get() < 0) {
         perror("socket failed");
-        return;
+        return false;
     }
 
     sockaddr_in address{};
@@ -32,83 +198,632 @@ void HttpServer::start() {
     address.sin_addr.s_addr = INADDR_ANY;
     address.sin_port = htons(port_number);
 
+    // Every reactor binds the same port; SO_REUSEPORT makes the kernel hash incoming
+    // connections across the listeners instead of waking all loops for each one.
     int opt = 1;
-    if (setsockopt(server_fd.get(), SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt)) <
-        0) {
+    if (setsockopt(listener.get(), SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+        setsockopt(listener.get(), SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
         perror("setsockopt failed");
-        return;
+        return false;
     }
 
-    if (bind(server_fd.get(), (struct sockaddr*)&address, sizeof(address)) < 0) {
+    if (bind(listener.get(), (struct sockaddr*)&address, sizeof(address)) < 0) {
         perror("bind failed");
-        return;
+        return false;
     }
 
-    if (listen(server_fd.get(), 10) < 0) {
+    if (listen(listener.get(), options.listen_backlog) < 0) {
         perror("listen failed");
-        return;
+        return false;
+    }
+
+    SocketHandler epoll(epoll_create1(EPOLL_CLOEXEC));
+    if (epoll.get() < 0) {
+        perror("epoll_create1 failed");
+        return false;
+    }
+
+    for (int fd : {listener.get(), reactor.wake.get()}) {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLET;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll.get(), EPOLL_CTL_ADD, fd, &event) < 0) {
+            perror("epoll_ctl failed");
+            return false;
+        }
     }
 
-    std::cout << "Server listening on port " << port_number << "\n";
+    reactor.listener = std::move(listener);
+    reactor.epoll = std::move(epoll);
+    return true;
+}
+
+void HttpServer::start() {
+    router.freeze();
+
+    // All listeners are bound before any loop runs, so a port that is taken fails here.
+    for (auto& reactor : reactors)
+        if (!open_listener(*reactor))
+            return;
+
+    signal(SIGPIPE, SIG_IGN); // sendfile has no MSG_NOSIGNAL
+
+    // Every event subscriber holds a descriptor for as long as its page is open.
+    rlimit files{};
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    // Reactor i goes to the i-th CPU the process may run on, wrapping if there are more
+    // reactors than CPUs.
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    std::vector<int> cpus;
+    if (options.pin_reactors && sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+    for (auto& reactor : reactors)
+        if (!cpus.empty())
+            reactor->cpu = cpus[reactor->index % cpus.size()];
+
+    auto listening_after = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - options.startup);
+    std::cout << "Server listening on port " << port_number << " with " << reactors.size()
+              << (reactors.size() == 1 ? " reactor" : " reactors") << " after "
+              << listening_after.count() << " ms\n";
 
     is_running = true;
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < reactors.size(); ++i)
+        threads.emplace_back(&HttpServer::run, this, std::ref(*reactors[i]));
+    run(*reactors[0]);
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void HttpServer::run(Reactor& reactor) {
+    if (reactor.cpu >= 0) {
+        cpu_set_t cpu;
+        CPU_ZERO(&cpu);
+        CPU_SET(reactor.cpu, &cpu);
+        if (int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu), &cpu))
+            std::cerr << "Pinning reactor " << reactor.index << " to CPU " << reactor.cpu
+                      << " failed: " << std::strerror(err) << "\n";
+    }
+
+    std::array<epoll_event, 128> events;
+    auto tick = std::chrono::duration_cast<std::chrono::milliseconds>(reactor.timers.tick_length());
+    int wait_ms = static_cast<int>(tick.count());
+    auto next_heartbeat = std::chrono::steady_clock::now() + options.event_heartbeat;
     while (is_running) {
-        socklen_t len = sizeof(address);
-        int client = accept(server_fd.get(), (struct sockaddr*)&address, &len);
+        int ready = epoll_wait(reactor.epoll.get(), events.data(), events.size(), wait_ms);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait failed");
+            break;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t flags = events[i].events;
+
+            if (fd == reactor.listener.get()) {
+                accept_clients(reactor);
+                continue;
+            }
+            if (fd == reactor.wake.get()) {
+                drain_completions(reactor);
+                broadcast_events(reactor);
+                continue;
+            }
+
+            auto it = reactor.connections.find(fd);
+            if (it == reactor.connections.end())
+                continue;
+            Connection& conn = *it->second;
+
+            bool alive = !(flags & EPOLLERR);
+            if (alive && (flags & (EPOLLIN | EPOLLHUP | EPOLLRDHUP)))
+                alive = read_client(conn);
+            if (alive && (flags & EPOLLOUT))
+                alive = flush_client(conn);
+            if (alive)
+                update_deadline(conn);
+            else
+                close_client(reactor, fd);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        reactor.timers.advance(now, [this, &reactor](TimerWheel::Timer& timer) {
+            expire(reactor, timer.owner);
+        });
+        // Comment frames keep intermediaries from timing out quiet streams and reveal
+        // subscribers that went away without a FIN.
+        if (now >= next_heartbeat) {
+            broadcast(reactor, heartbeat_frame);
+            next_heartbeat = now + options.event_heartbeat;
+        }
+    }
+
+    reactor.connections.clear();
+}
+
+void HttpServer::accept_clients(Reactor& reactor) {
+    for (;;) {
+        int client =
+            accept4(reactor.listener.get(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
         if (client < 0) {
-            perror("accept failed");
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("accept failed");
+            return;
+        }
+
+        int opt = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = client;
+        if (epoll_ctl(reactor.epoll.get(), EPOLL_CTL_ADD, client, &event) < 0) {
+            perror("epoll_ctl failed");
+            close(client);
             continue;
         }
-        std::thread(&HttpServer::handle_client, this, client).detach();
+        auto conn = std::make_unique<Connection>(client, options);
+        conn->id = ++reactor.next_connection_id;
+        conn->reactor = &reactor;
+        update_deadline(*conn);
+        reactor.connections.emplace(client, std::move(conn));
     }
 }
 
-void HttpServer::handle_client(int client_socket) {
-    SocketHandler client(client_socket);
+void HttpServer::close_client(Reactor& reactor, int client_socket) {
+    epoll_ctl(reactor.epoll.get(), EPOLL_CTL_DEL, client_socket, nullptr);
+    reactor.subscribers.erase(client_socket);
+    reactor.connections.erase(client_socket);
+}
+
+// Called after every event on a connection. The deadline restarts when the connection starts
+// waiting on something else, and for idle, body and write waits whenever bytes moved. The
+// header deadline only restarts for a new request, so a client trickling a header a byte at a
+// time still runs out of time. Connections waiting on a handler or an idle event stream have
+// no deadline; the worker pool and heartbeats bound those.
+void HttpServer::update_deadline(Connection& conn) {
+    Phase phase;
+    if (conn.out.pending_bytes() > 0)
+        phase = Phase::Write;
+    else if (conn.awaiting_handler || conn.streaming)
+        phase = Phase::None;
+    else if (conn.in_size > conn.in_offset)
+        phase = conn.parser.headers_complete() ? Phase::Body : Phase::Header;
+    else
+        phase = Phase::Idle;
+
+    bool restart = phase != conn.phase || (phase == Phase::Header
+                                               ? conn.requests_served != conn.phase_request
+                                               : conn.moved_bytes);
+    conn.phase = phase;
+    conn.moved_bytes = false;
+    if (phase == Phase::None) {
+        conn.deadline.cancel();
+        return;
+    }
+    if (!restart)
+        return;
+
+    std::chrono::seconds timeout = options.keep_alive_timeout;
+    if (phase == Phase::Header)
+        timeout = options.header_timeout;
+    else if (phase == Phase::Body)
+        timeout = options.body_timeout;
+    else if (phase == Phase::Write)
+        timeout = options.write_timeout;
+    conn.phase_request = conn.requests_served;
+    conn.reactor->timers.schedule(conn.deadline, std::chrono::steady_clock::now() + timeout);
+}
 
-    std::string request;
-    char tmp[1024];
-    ssize_t n;
-    while ((n = read(client.get(), tmp, sizeof(tmp))) > 0) {
-        request.append(tmp, n);
-        if (request.size() >= 4 && request.substr(request.size() - 4) == "\r\n\r\n") {
+// A client that stopped part way through a request is told why before the connection goes.
+void HttpServer::expire(Reactor& reactor, int client_socket) {
+    auto it = reactor.connections.find(client_socket);
+    if (it == reactor.connections.end())
+        return;
+    Connection& conn = *it->second;
+    timeouts[static_cast<size_t>(conn.phase)]->add();
+    if (conn.phase == Phase::Header || conn.phase == Phase::Body) {
+        conn.out.append("HTTP/1.1 408 Request Timeout\r\n"
+                        "Content-Length: 0\r\n"
+                        "Connection: close\r\n\r\n");
+        flush_client(conn);
+    }
+    close_client(reactor, client_socket);
+}
+
+// Edge-triggered: drain the socket completely, then serve whatever complete requests are
+// buffered and push the responses out. Requests are read straight into the connection's
+// fixed buffer; when it fills up, complete requests are served to make room. If none can be
+// (a handler is still running), reading pauses until drain_completions() resumes it.
+bool HttpServer::read_client(Connection& conn) {
+    char discard[4096];
+    for (;;) {
+        // Once nothing more will be served, input is only read to notice the peer closing.
+        bool accepting = !conn.close_after_write && !conn.streaming;
+        if (accepting && conn.in_size == input_capacity) {
+            handle_client(conn);
+            if (conn.in_size == input_capacity) {
+                conn.input_paused = true;
+                break;
+            }
+            continue;
+        }
+
+        char* into = accepting ? conn.in.get() + conn.in_size : discard;
+        size_t room = accepting ? input_capacity - conn.in_size : sizeof(discard);
+        ssize_t n = read(conn.socket.get(), into, room);
+        if (n > 0) {
+            if (accepting)
+                conn.in_size += n;
+            conn.moved_bytes = true;
+            continue;
+        }
+        if (n == 0) {
+            conn.peer_closed = true;
             break;
         }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        return false;
     }
 
-    std::istringstream req(request);
-    std::string method, raw_path;
-    req >> method >> raw_path;
+    handle_client(conn);
+    return flush_client(conn);
+}
+
+// Serves every complete request already buffered, in order, so pipelined requests are
+// answered back to back without waiting for another read.
+void HttpServer::handle_client(Connection& conn) {
+    while (!conn.close_after_write && !conn.awaiting_handler && !conn.streaming &&
+           conn.in_offset < conn.in_size) {
+        std::string_view pending(conn.in.get() + conn.in_offset, conn.in_size - conn.in_offset);
+
+        auto state = conn.parser.parse(pending, conn.request);
+        if (state == HttpRequestParser::State::Incomplete)
+            break;
+
+        if (state == HttpRequestParser::State::Error) {
+            malformed.add();
+            conn.out.append("HTTP/1.1 " + std::string(conn.parser.error_status()) +
+                            "\r\n"
+                            "Content-Length: 0\r\n"
+                            "Connection: close\r\n\r\n");
+            conn.close_after_write = true;
+            break;
+        }
 
-    std::string path = raw_path.substr(0, raw_path.find('?'));
-    if (!path.empty() && path.back() == '/')
-        path.pop_back();
+        conn.in_offset += conn.parser.consumed();
+        conn.parser.reset();
+        ++conn.requests_served;
 
-    std::string body, type, status;
+        bool keep_alive = wants_keep_alive(conn.request) &&
+                          conn.requests_served < options.max_keep_alive_requests;
+        dispatch(conn, keep_alive);
+    }
 
-    if (current_routes.contains(path)) {
+    // After a half-close every complete request still gets its answer; the connection is only
+    // marked to close once no handler is pending, since requests queued behind one are still
+    // in the buffer. Whatever is left then is a partial request that can never complete.
+    if (conn.peer_closed && !conn.awaiting_handler)
+        conn.close_after_write = true;
+
+    // The partial request left over moves to the front. The parser's offsets are relative
+    // to it and survive the move; the request's views do not, so the parser takes them again
+    // when it next sees the data at a different address.
+    if (conn.streaming) {
+        conn.in.reset();
+        conn.in_size = 0;
+        conn.in_offset = 0;
+    } else if (conn.in_offset == conn.in_size || conn.close_after_write) {
+        conn.in_size = 0;
+        conn.in_offset = 0;
+    } else if (conn.in_offset > 0) {
+        std::memmove(conn.in.get(), conn.in.get() + conn.in_offset, conn.in_size - conn.in_offset);
+        conn.in_size -= conn.in_offset;
+        conn.in_offset = 0;
+    }
+}
+
+bool HttpServer::flush_client(Connection& conn) {
+    size_t written = 0;
+    auto result = conn.out.flush(conn.socket.get(), written);
+    if (written > 0) {
+        bytes_sent.add(written);
+        conn.moved_bytes = true;
+        if (int64_t unset = -1; first_byte_ms.load(std::memory_order_relaxed) < 0) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - options.startup);
+            // Reactors race for the first byte; only the winner reports it.
+            if (first_byte_ms.compare_exchange_strong(unset, elapsed.count(),
+                                                      std::memory_order_relaxed))
+                std::cout << "First response byte sent " << elapsed.count()
+                          << " ms after startup\n";
+        }
+    }
+
+    if (result == OutputBuffer::Result::Error)
+        return false;
+    if (result == OutputBuffer::Result::WouldBlock)
+        return true;
+    return !conn.close_after_write || conn.awaiting_handler;
+}
+
+void HttpServer::dispatch(Connection& conn, bool keep_alive) {
+    std::string_view path = conn.request.path;
+    if (path.size() > 1 && path.back() == '/')
+        path.remove_suffix(1);
+
+    Router::Match match;
+    auto result = router.find(conn.request.method, path, match);
+    if (result == Router::Result::Found) {
+        const Route& route = routes[match.route];
+        auto start = std::chrono::steady_clock::now();
+        size_t queued = conn.out.pending_bytes();
+        switch (route.kind) {
+        case Route::Kind::Handler:
+            run_handler(conn, route, keep_alive);
+            return;
+        case Route::Kind::Events:
+            subscribe(conn);
+            route.observe(start, conn.out.pending_bytes() - queued);
+            return;
+        case Route::Kind::Cached:
+            if (auto cached = response_cache->find(route.key)) {
+                serve_cached(conn, std::move(cached), keep_alive);
+                route.observe(start, conn.out.pending_bytes() - queued);
+                return;
+            }
+            break;
+        case Route::Kind::Static: {
+            // The wildcard is a view into the request path, so the slash before it is there.
+            std::string_view rest = match.params.get("*");
+            std::string_view asset_path(rest.data() - 1, rest.size() + 1);
+            if (auto asset = route.assets->find(asset_path)) {
+                serve_static(conn, std::move(asset), keep_alive);
+                route.observe(start, conn.out.pending_bytes() - queued);
+                return;
+            }
+            break;
+        }
+        }
+    }
+
+    if (result == Router::Result::MethodNotAllowed) {
+        method_not_allowed.add();
+        conn.out.append(format_response("405 Method Not Allowed", "application/json",
+                                        R"({"error":"Method Not Allowed"})", keep_alive,
+                                        "Allow: " + std::string(match.allowed) + "\r\n"));
+    } else {
+        not_found.add();
+        conn.out.append(format_response("404 Not Found", "application/json",
+                                        R"({"error":"Not Found"})", keep_alive));
+    }
+    conn.close_after_write = !keep_alive;
+}
+
+// Handlers may block on upstream I/O, so they run on the worker pool. The connection stops
+// parsing until the response comes back, which keeps pipelined responses in order. The
+// worker matches its own copy of the path again, so route parameters never point into a
+// connection that may be gone by the time it runs.
+void HttpServer::run_handler(Connection& conn, const Route& route, bool keep_alive) {
+    bool queued = pool.try_submit([this, route = &route,
+                                   method = std::string(conn.request.method),
+                                   path = std::string(conn.request.path),
+                                   reactor = conn.reactor, fd = conn.socket.get(), id = conn.id,
+                                   keep_alive]() {
+        auto start = std::chrono::steady_clock::now();
+        std::string response;
         try {
-            auto [b, t] = current_routes[path]();
-            body = b;
-            type = t;
-            status = "HTTP/1.1 200 OK\r\n";
+            std::string_view target = path;
+            if (target.size() > 1 && target.back() == '/')
+                target.remove_suffix(1);
+            Router::Match match;
+            router.find(method, target, match);
+            auto [body, type] = route->handler(match.params);
+            response = format_response("200 OK", type, body, keep_alive);
+        } catch (const RouteNotFound&) {
+            response = format_response("404 Not Found", "application/json",
+                                       R"({"error":"Not Found"})", keep_alive);
         } catch (const std::exception&) {
-            body = R"({"error":"Internal Server Error"})";
-            type = "application/json";
-            status = "HTTP/1.1 500 Internal Server Error\r\n";
+            response = format_response("500 Internal Server Error", "application/json",
+                                       R"({"error":"Internal Server Error"})", keep_alive);
+        }
+        route->observe(start, response.size());
+
+        {
+            std::lock_guard lock(reactor->inbox_mutex);
+            reactor->completions.push_back({fd, id, std::move(response), keep_alive});
         }
+        reactor->wake_up();
+    });
+
+    if (queued) {
+        conn.awaiting_handler = true;
+        return;
+    }
+
+    overloaded.add();
+    conn.out.append(format_response("503 Service Unavailable", "application/json",
+                                    R"({"error":"Service Unavailable"})", keep_alive,
+                                    "Retry-After: " +
+                                        std::to_string(options.retry_after.count()) + "\r\n"));
+    conn.close_after_write = !keep_alive;
+}
+
+// Static files are answered on the loop without a worker. The body is never copied: small
+// files are referenced straight from the cache, large ones are sent with sendfile.
+void HttpServer::serve_static(Connection& conn, std::shared_ptr<const StaticAsset> asset,
+                              bool keep_alive) {
+    const EncodedBody* variant = negotiate(conn.request.accept_encoding, asset->variants);
+    std::string_view etag = variant ? std::string_view(variant->etag) : asset->etag;
+    bool not_modified = etag_matches(conn.request.if_none_match, etag);
+
+    std::ostringstream res;
+    res << (not_modified ? "HTTP/1.1 304 Not Modified\r\n" : "HTTP/1.1 200 OK\r\n")
+        << "ETag: " << etag << "\r\n"
+        << "Cache-Control: " << asset->cache_control << "\r\n";
+    if (!asset->variants.empty())
+        res << "Vary: Accept-Encoding\r\n";
+    if (!not_modified) {
+        res << "Content-Type: " << asset->content_type << "\r\n";
+        if (variant)
+            res << "Content-Encoding: " << content_coding(variant->encoding) << "\r\n";
+        res << "Content-Length: " << (variant ? variant->body.size() : asset->size) << "\r\n";
+    }
+
+    conn.out.append(res.str());
+    append_connection_headers(conn, keep_alive);
+    if (!not_modified) {
+        if (variant) {
+            std::string_view body = variant->body;
+            conn.out.append(std::move(asset), body);
+        } else if (asset->file.get() >= 0) {
+            int file_fd = asset->file.get();
+            size_t size = asset->size;
+            conn.out.append_file(std::move(asset), file_fd, 0, size);
+        } else {
+            std::string_view body = asset->body;
+            conn.out.append(std::move(asset), body);
+        }
+    }
+    conn.close_after_write = !keep_alive;
+}
+
+// Pre-rendered endpoints are answered on the loop as well. Nothing is formatted per request:
+// the cached head and body and the shared Connection block go out as three borrowed iovecs.
+// Accept-Encoding only chooses which pre-compressed variant those iovecs point into.
+void HttpServer::serve_cached(Connection& conn, std::shared_ptr<const CachedResponse> response,
+                              bool keep_alive) {
+    std::string_view etag = response->etag;
+    std::string_view head = response->head;
+    std::string_view not_modified = response->not_modified;
+    std::string_view body = response->body;
+    if (auto* variant = negotiate(conn.request.accept_encoding, response->variants)) {
+        etag = variant->etag;
+        head = variant->head;
+        not_modified = variant->not_modified;
+        body = variant->body;
+    }
+
+    if (etag_matches(conn.request.if_none_match, etag)) {
+        conn.out.append(std::move(response), not_modified);
+        append_connection_headers(conn, keep_alive);
     } else {
-        body = R"({"error":"Not Found"})";
-        type = "application/json";
-        status = "HTTP/1.1 404 Not Found\r\n";
+        conn.out.append(response, head);
+        append_connection_headers(conn, keep_alive);
+        conn.out.append(std::move(response), body);
+    }
+    conn.close_after_write = !keep_alive;
+}
+
+void HttpServer::append_connection_headers(Connection& conn, bool keep_alive) const {
+    const auto& headers = keep_alive ? keep_alive_headers : close_headers;
+    conn.out.append(headers, *headers);
+}
+
+// The response to a subscription never ends; the body is delimited by closing the
+// connection, so it stays open until the client leaves. The latest state of every event
+// type goes out first so the page can render without a separate fetch.
+void HttpServer::subscribe(Connection& conn) {
+    conn.out.append("HTTP/1.1 200 OK\r\n"
+                    "Content-Type: text/event-stream\r\n"
+                    "Cache-Control: no-cache\r\n"
+                    "X-Accel-Buffering: no\r\n"
+                    "Connection: close\r\n\r\n"
+                    "retry: 5000\n\n");
+    for (auto& frame : event_stream->current())
+        conn.out.append(frame, *frame);
+    conn.streaming = true;
+    conn.reactor->subscribers.insert(conn.socket.get());
+}
+
+void HttpServer::broadcast_events(Reactor& reactor) {
+    std::vector<EventStream::Frame> frames;
+    {
+        std::lock_guard lock(reactor.inbox_mutex);
+        frames.swap(reactor.frames);
+    }
+    for (auto& frame : frames)
+        broadcast(reactor, frame);
+}
+
+// Every subscriber references the same frame. A subscriber that cannot keep up is dropped
+// rather than buffered without bound; EventSource reconnects and resyncs from current().
+void HttpServer::broadcast(Reactor& reactor, const EventStream::Frame& frame) {
+    std::vector<int> dropped;
+    for (int fd : reactor.subscribers) {
+        auto it = reactor.connections.find(fd);
+        if (it == reactor.connections.end())
+            continue;
+        Connection& conn = *it->second;
+        conn.out.append(frame, *frame);
+        if (conn.out.pending_bytes() > options.max_event_backlog || !flush_client(conn))
+            dropped.push_back(fd);
+        else
+            update_deadline(conn);
+    }
+    for (int fd : dropped)
+        close_client(reactor, fd);
+}
+
+void HttpServer::drain_completions(Reactor& reactor) {
+    uint64_t count;
+    while (read(reactor.wake.get(), &count, sizeof(count)) > 0) {
     }
 
+    std::vector<Completion> ready;
+    {
+        std::lock_guard lock(reactor.inbox_mutex);
+        ready.swap(reactor.completions);
+    }
+
+    for (auto& done : ready) {
+        auto it = reactor.connections.find(done.fd);
+        if (it == reactor.connections.end() || it->second->id != done.connection_id)
+            continue;
+
+        Connection& conn = *it->second;
+        conn.awaiting_handler = false;
+        conn.out.append(std::move(done.response));
+        if (!done.keep_alive)
+            conn.close_after_write = true;
+
+        handle_client(conn);
+        bool alive;
+        if (conn.input_paused) {
+            conn.input_paused = false;
+            alive = read_client(conn);
+        } else {
+            alive = flush_client(conn);
+        }
+        if (alive)
+            update_deadline(conn);
+        else
+            close_client(reactor, done.fd);
+    }
+}
+
+std::string HttpServer::format_response(std::string_view status, std::string_view type,
+                                        std::string_view body, bool keep_alive,
+                                        std::string_view extra_headers) const {
     std::ostringstream res;
-    res << status << "Content-Type: " << type << "\r\n"
+    res << "HTTP/1.1 " << status << "\r\n"
+        << "Content-Type: " << type << "\r\n"
         << "Content-Length: " << body.size() << "\r\n"
-        << "Connection: close\r\n\r\n"
-        << body;
-
-    auto s = res.str();
-    send(client.get(), s.c_str(), s.size(), 0);
+        << extra_headers << (keep_alive ? *keep_alive_headers : *close_headers) << body;
+    return res.str();
 }
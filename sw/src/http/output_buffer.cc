@@ -0,0 +1,136 @@
+#include "http/output_buffer.h"
+#include <cerrno>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace {
+
+constexpr size_t max_iov = 64;
+
+} // namespace
+
+void OutputBuffer::append(std::string data) {
+    if (data.empty())
+        return;
+    pending += data.size();
+
+    // Headers are built in a few pieces; keep them in one segment so they go out in one iovec.
+    if (!segments.empty()) {
+        Segment& last = segments.back();
+        if (!last.owner && last.file_fd < 0) {
+            size_t used = last.data - last.owned.data();
+            last.owned += data;
+            last.data = last.owned.data() + used;
+            last.size += data.size();
+            return;
+        }
+    }
+
+    Segment& seg = segments.emplace_back();
+    seg.owned = std::move(data);
+    seg.data = seg.owned.data();
+    seg.size = seg.owned.size();
+}
+
+void OutputBuffer::append(std::shared_ptr<const void> owner, std::string_view data) {
+    if (data.empty())
+        return;
+    pending += data.size();
+
+    Segment& seg = segments.emplace_back();
+    seg.owner = std::move(owner);
+    seg.data = data.data();
+    seg.size = data.size();
+}
+
+void OutputBuffer::append_file(std::shared_ptr<const void> owner, int file_fd, off_t offset,
+                               size_t length) {
+    if (length == 0)
+        return;
+    pending += length;
+
+    Segment& seg = segments.emplace_back();
+    seg.owner = std::move(owner);
+    seg.file_fd = file_fd;
+    seg.file_offset = offset;
+    seg.size = length;
+}
+
+OutputBuffer::Result OutputBuffer::flush(int socket, size_t& written) {
+    written = 0;
+    while (!segments.empty()) {
+        Segment& front = segments.front();
+
+        if (front.file_fd >= 0) {
+            ssize_t n = sendfile(socket, front.file_fd, &front.file_offset, front.size);
+            if (n > 0) {
+                written += n;
+                pending -= n;
+                front.size -= n;
+                if (front.size == 0)
+                    segments.pop_front();
+                continue;
+            }
+            if (n == 0)
+                return Result::Error; // file shrank underneath us
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN ? Result::WouldBlock : Result::Error;
+        }
+
+        iovec iov[max_iov];
+        size_t count = 0;
+        for (auto& seg : segments) {
+            if (seg.file_fd >= 0 || count == max_iov)
+                break;
+            iov[count].iov_base = const_cast<char*>(seg.data);
+            iov[count].iov_len = seg.size;
+            ++count;
+        }
+
+        // sendmsg is writev with MSG_NOSIGNAL, so a vanished peer is an error, not SIGPIPE.
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg(socket, &msg, MSG_NOSIGNAL);
+        if (n > 0) {
+            written += n;
+            consume(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EAGAIN)
+            return Result::WouldBlock;
+        return Result::Error;
+    }
+    return Result::Done;
+}
+
+void OutputBuffer::consume(size_t bytes) {
+    pending -= bytes;
+    while (bytes > 0) {
+        Segment& front = segments.front();
+        if (bytes < front.size) {
+            front.data += bytes;
+            front.size -= bytes;
+            return;
+        }
+        bytes -= front.size;
+        segments.pop_front();
+    }
+}
+
+bool OutputBuffer::empty() const {
+    return segments.empty();
+}
+
+size_t OutputBuffer::pending_bytes() const {
+    return pending;
+}
+
+void OutputBuffer::clear() {
+    segments.clear();
+    pending = 0;
+}
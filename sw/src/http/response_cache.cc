@@ -0,0 +1,103 @@
+#include "http/response_cache.h"
+#include "http/etag.h"
+#include <iostream>
+
+ResponseCache::ResponseCache(size_t compress_min_bytes) : compress_min_bytes(compress_min_bytes) {
+}
+
+void ResponseCache::add(const std::string& path, VersionSource version, Renderer render) {
+    auto entry = std::make_unique<Entry>();
+    entry->version = std::move(version);
+    entry->render = std::move(render);
+    entries[path] = std::move(entry);
+}
+
+// Called from the refresh jobs after they publish. Several jobs may finish at once, so
+// rendering is serialized; that also keeps each entry's Snapshot single-writer.
+void ResponseCache::refresh() {
+    std::lock_guard lock(refresh_mutex);
+    for (auto& [path, entry] : entries) {
+        uint64_t version = entry->version();
+        if (entry->rendered && version == entry->rendered_version)
+            continue;
+
+        std::pair<std::string, std::string> rendered;
+        try {
+            rendered = entry->render();
+        } catch (const std::exception& ex) {
+            std::cerr << "Rendering " << path << " failed: " << ex.what() << "\n";
+            continue;
+        }
+        entry->rendered = true;
+        entry->rendered_version = version;
+
+        // A new source version with the same bytes keeps its validator, so pollers still
+        // get 304s when a refresh changed nothing visible.
+        auto& [body, type] = rendered;
+        std::string etag = strong_etag(body);
+        if (auto current = entry->response.load(); !current->head.empty() && current->etag == etag)
+            continue;
+
+        CachedResponse response;
+        response.version = version;
+        if (is_compressible(type)) {
+            for (auto& encoded : compress_variants(body, compress_min_bytes)) {
+                CachedResponse::Variant variant;
+                std::string coding(content_coding(encoded.encoding));
+                variant.encoding = encoded.encoding;
+                variant.etag = std::move(encoded.etag);
+                variant.head = "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: " + type + "\r\n"
+                               "Content-Encoding: " + coding + "\r\n"
+                               "Content-Length: " + std::to_string(encoded.body.size()) + "\r\n"
+                               "ETag: " + variant.etag + "\r\n"
+                               "Cache-Control: no-cache\r\n"
+                               "Vary: Accept-Encoding\r\n";
+                variant.not_modified = "HTTP/1.1 304 Not Modified\r\n"
+                                       "ETag: " + variant.etag + "\r\n"
+                                       "Cache-Control: no-cache\r\n"
+                                       "Vary: Accept-Encoding\r\n";
+                variant.body = std::move(encoded.body);
+                response.variants.push_back(std::move(variant));
+            }
+        }
+        // Caches must key on Accept-Encoding as soon as there is anything to choose between.
+        std::string vary = response.variants.empty() ? "" : "Vary: Accept-Encoding\r\n";
+        response.etag = std::move(etag);
+        response.head = "HTTP/1.1 200 OK\r\n"
+                        "Content-Type: " + type + "\r\n"
+                        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                        "ETag: " + response.etag + "\r\n"
+                        "Cache-Control: no-cache\r\n" + vary;
+        response.not_modified = "HTTP/1.1 304 Not Modified\r\n"
+                                "ETag: " + response.etag + "\r\n"
+                                "Cache-Control: no-cache\r\n" + vary;
+        response.body = std::move(body);
+        auto published = std::make_shared<const CachedResponse>(std::move(response));
+        entry->response.publish(published);
+        if (listener)
+            listener(path, *published);
+    }
+}
+
+void ResponseCache::on_change(Listener callback) {
+    std::lock_guard lock(refresh_mutex);
+    listener = std::move(callback);
+}
+
+std::shared_ptr<const CachedResponse> ResponseCache::find(std::string_view path) const {
+    auto it = entries.find(path);
+    if (it == entries.end())
+        return nullptr;
+    auto response = it->second->response.load();
+    if (response->head.empty())
+        return nullptr;
+    return response;
+}
+
+std::vector<std::string> ResponseCache::paths() const {
+    std::vector<std::string> out;
+    for (const auto& [path, entry] : entries)
+        out.push_back(path);
+    return out;
+}
@@ -0,0 +1,192 @@
+#include "http/router.h"
+#include <algorithm>
+#include <stdexcept>
+
+std::string_view RouteParams::get(std::string_view name) const {
+    for (size_t i = 0; i < count; ++i)
+        if (items[i].first == name)
+            return items[i].second;
+    return {};
+}
+
+Router::Router() : nodes(1) {
+}
+
+void Router::add(std::string_view method, std::string_view pattern, uint32_t route) {
+    if (is_frozen)
+        throw std::logic_error("route added after the router was frozen");
+    if (pattern.empty() || pattern.front() != '/')
+        throw std::invalid_argument("route pattern must start with '/': " + std::string(pattern));
+
+    uint32_t at = 0;
+    size_t params = 0;
+    std::string_view rest = pattern;
+    while (!rest.empty()) {
+        size_t special = rest.find_first_of("{*");
+        at = insert_literal(at, rest.substr(0, special));
+        if (special == std::string_view::npos)
+            break;
+        rest.remove_prefix(special);
+
+        if (++params > RouteParams::max_params)
+            throw std::invalid_argument("too many parameters in " + std::string(pattern));
+
+        if (rest.front() == '*') {
+            if (rest.size() != 1)
+                throw std::invalid_argument("'*' must end the pattern: " + std::string(pattern));
+            at = insert_placeholder(at, Kind::Wildcard, "*");
+            break;
+        }
+
+        size_t close = rest.find('}');
+        std::string_view name = rest.substr(1, close == std::string_view::npos ? 0 : close - 1);
+        if (close == std::string_view::npos || name.empty() ||
+            name.find('/') != std::string_view::npos)
+            throw std::invalid_argument("malformed parameter in " + std::string(pattern));
+        at = insert_placeholder(at, Kind::Param, name);
+        rest.remove_prefix(close + 1);
+        if (!rest.empty() && rest.front() != '/')
+            throw std::invalid_argument("parameter must span a whole segment: " +
+                                        std::string(pattern));
+    }
+
+    for (const auto& endpoint : nodes[at].endpoints)
+        if (endpoint.method == method)
+            throw std::invalid_argument("duplicate route " + std::string(method) + " " +
+                                        std::string(pattern));
+    nodes[at].endpoints.push_back({std::string(method), route});
+}
+
+// Walks down the literal edges that share a prefix with text, splitting an edge where the
+// text diverges, and returns the node that ends exactly at the end of text.
+uint32_t Router::insert_literal(uint32_t at, std::string_view text) {
+    while (!text.empty()) {
+        int32_t child = literal_child(nodes[at], text.front());
+        if (child < 0) {
+            Node leaf;
+            leaf.label = text;
+            nodes.push_back(std::move(leaf));
+            uint32_t index = nodes.size() - 1;
+            nodes[at].children.push_back(index);
+            return index;
+        }
+
+        const std::string& label = nodes[child].label;
+        size_t common = std::mismatch(label.begin(), label.end(), text.begin(), text.end()).first -
+                        label.begin();
+        if (common < label.size()) {
+            Node mid;
+            mid.label = label.substr(0, common);
+            mid.children.push_back(child);
+            nodes[child].label.erase(0, common);
+            nodes.push_back(std::move(mid));
+            uint32_t index = nodes.size() - 1;
+            std::replace(nodes[at].children.begin(), nodes[at].children.end(),
+                         static_cast<uint32_t>(child), index);
+            child = index;
+        }
+        at = child;
+        text.remove_prefix(common);
+    }
+    return at;
+}
+
+uint32_t Router::insert_placeholder(uint32_t at, Kind kind, std::string_view name) {
+    int32_t existing = kind == Kind::Param ? nodes[at].param_child : nodes[at].wildcard_child;
+    if (existing >= 0) {
+        if (nodes[existing].label != name)
+            throw std::invalid_argument("conflicting parameter names {" + nodes[existing].label +
+                                        "} and {" + std::string(name) + "}");
+        return existing;
+    }
+
+    Node node;
+    node.kind = kind;
+    node.label = name;
+    nodes.push_back(std::move(node));
+    uint32_t index = nodes.size() - 1;
+    if (kind == Kind::Param)
+        nodes[at].param_child = index;
+    else
+        nodes[at].wildcard_child = index;
+    return index;
+}
+
+void Router::freeze() {
+    for (auto& node : nodes) {
+        std::sort(node.children.begin(), node.children.end(), [this](uint32_t a, uint32_t b) {
+            return static_cast<unsigned char>(nodes[a].label.front()) <
+                   static_cast<unsigned char>(nodes[b].label.front());
+        });
+        node.children.shrink_to_fit();
+        for (const auto& endpoint : node.endpoints)
+            node.allowed += (node.allowed.empty() ? "" : ", ") + endpoint.method;
+    }
+    nodes.shrink_to_fit();
+    is_frozen = true;
+}
+
+bool Router::frozen() const {
+    return is_frozen;
+}
+
+// Children are few and keyed by distinct first bytes; a linear scan beats anything fancier.
+int32_t Router::literal_child(const Node& node, unsigned char first) const {
+    for (uint32_t child : node.children)
+        if (static_cast<unsigned char>(nodes[child].label.front()) == first)
+            return child;
+    return -1;
+}
+
+Router::Result Router::find(std::string_view method, std::string_view path, Match& match) const {
+    match.params.count = 0;
+    const Node* path_match = nullptr;
+    if (walk(0, method, path, match, path_match))
+        return Result::Found;
+    if (path_match) {
+        match.allowed = path_match->allowed;
+        return Result::MethodNotAllowed;
+    }
+    return Result::NotFound;
+}
+
+bool Router::walk(uint32_t at, std::string_view method, std::string_view rest, Match& match,
+                  const Node*& path_match) const {
+    const Node& node = nodes[at];
+
+    if (rest.empty() && !node.endpoints.empty()) {
+        for (const auto& endpoint : node.endpoints)
+            if (endpoint.method == method) {
+                match.route = endpoint.route;
+                return true;
+            }
+        if (!path_match)
+            path_match = &node;
+    }
+
+    if (!rest.empty()) {
+        int32_t child = literal_child(node, rest.front());
+        if (child >= 0 && rest.starts_with(nodes[child].label) &&
+            walk(child, method, rest.substr(nodes[child].label.size()), match, path_match))
+            return true;
+    }
+
+    size_t saved = match.params.count;
+    if (node.param_child >= 0) {
+        std::string_view segment = rest.substr(0, rest.find('/'));
+        if (!segment.empty()) {
+            match.params.items[match.params.count++] = {nodes[node.param_child].label, segment};
+            if (walk(node.param_child, method, rest.substr(segment.size()), match, path_match))
+                return true;
+            match.params.count = saved;
+        }
+    }
+
+    if (node.wildcard_child >= 0) {
+        match.params.items[match.params.count++] = {"*", rest};
+        if (walk(node.wildcard_child, method, {}, match, path_match))
+            return true;
+        match.params.count = saved;
+    }
+    return false;
+}
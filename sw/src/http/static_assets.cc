@@ -0,0 +1,198 @@
+#include "http/static_assets.h"
+#include "http/etag.h"
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <sys/inotify.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string content_type_for(const fs::path& file_path) {
+    std::string ext = file_path.extension().string();
+    if (ext == ".html")
+        return "text/html; charset=utf-8";
+    if (ext == ".css")
+        return "text/css; charset=utf-8";
+    if (ext == ".js")
+        return "application/javascript; charset=utf-8";
+    if (ext == ".json")
+        return "application/json";
+    if (ext == ".svg")
+        return "image/svg+xml";
+    if (ext == ".png")
+        return "image/png";
+    if (ext == ".ico")
+        return "image/x-icon";
+    if (ext == ".txt")
+        return "text/plain; charset=utf-8";
+    return "application/octet-stream";
+}
+
+// Documents are revalidated on every load so edits show up at once; everything else is
+// immutable enough to live in the browser cache and only be revalidated with the ETag.
+std::string cache_control_for(const fs::path& file_path) {
+    std::string ext = file_path.extension().string();
+    if (ext == ".html")
+        return "no-cache";
+    if (ext == ".css" || ext == ".js")
+        return "public, max-age=3600";
+    return "public, max-age=86400";
+}
+
+// Hashes a file-backed asset without keeping its contents around.
+bool hash_file(int fd, size_t& size, uint64_t& hash) {
+    char buf[16384];
+    size = 0;
+    hash = fnv_offset;
+    for (;;) {
+        ssize_t n = pread(fd, buf, sizeof(buf), size);
+        if (n < 0)
+            return false;
+        if (n == 0)
+            return true;
+        hash = fnv1a(hash, std::string_view(buf, n));
+        size += n;
+    }
+}
+
+} // namespace
+
+StaticAssets::StaticAssets(fs::path root, size_t inline_limit, size_t compress_min_bytes)
+    : root(std::move(root)), inline_limit(inline_limit), compress_min_bytes(compress_min_bytes) {
+    load();
+}
+
+StaticAssets::~StaticAssets() {
+    watching = false;
+    if (watcher.joinable())
+        watcher.join();
+}
+
+void StaticAssets::load() {
+    auto loaded = std::make_shared<AssetMap>();
+
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(root, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (!it->is_regular_file())
+            continue;
+
+        std::shared_ptr<StaticAsset> asset;
+        std::string content_type = content_type_for(it->path());
+        bool compressible = is_compressible(content_type);
+        std::error_code size_ec;
+        if (it->file_size(size_ec) > inline_limit && !size_ec) {
+            int fd = open(it->path().c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                continue;
+            asset = std::make_shared<StaticAsset>(fd);
+            uint64_t hash;
+            if (!hash_file(fd, asset->size, hash))
+                continue;
+            asset->etag = strong_etag(asset->size, hash);
+            // Large text files are read once more to compress; only the result is kept.
+            if (compressible) {
+                std::ifstream file(it->path(), std::ios::binary);
+                std::stringstream buffer;
+                buffer << file.rdbuf();
+                if (file)
+                    asset->variants = compress_variants(buffer.str(), compress_min_bytes);
+            }
+        } else {
+            std::ifstream file(it->path(), std::ios::binary);
+            if (!file)
+                continue;
+            std::stringstream buffer;
+            buffer << file.rdbuf();
+
+            asset = std::make_shared<StaticAsset>();
+            asset->body = buffer.str();
+            asset->size = asset->body.size();
+            asset->etag = strong_etag(asset->body);
+            if (compressible)
+                asset->variants = compress_variants(asset->body, compress_min_bytes);
+        }
+        asset->content_type = std::move(content_type);
+        asset->cache_control = cache_control_for(it->path());
+
+        std::string route = "/";
+        route += fs::relative(it->path(), root).generic_string();
+        (*loaded)[route] = std::move(asset);
+    }
+
+    if (ec)
+        std::cerr << "Static asset scan of " << root << " failed: " << ec.message() << "\n";
+
+    assets.store(std::move(loaded));
+}
+
+std::shared_ptr<const StaticAsset> StaticAssets::find(std::string_view path) const {
+    if (path.empty() || path == "/")
+        path = "/index.html";
+
+    auto snapshot = assets.load();
+    auto it = snapshot->find(path);
+    if (it == snapshot->end())
+        return nullptr;
+    return it->second;
+}
+
+size_t StaticAssets::size() const {
+    return assets.load()->size();
+}
+
+const fs::path& StaticAssets::root_dir() const {
+    return root;
+}
+
+bool StaticAssets::watch() {
+    if (watching.exchange(true))
+        return true;
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        perror("inotify_init1 failed");
+        watching = false;
+        return false;
+    }
+    watcher = std::thread(&StaticAssets::watch_loop, this, fd);
+    return true;
+}
+
+void StaticAssets::watch_loop(int inotify_fd) {
+    SocketHandler inotify(inotify_fd);
+    constexpr uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+
+    auto add_watches = [&]() {
+        inotify_add_watch(inotify.get(), root.c_str(), mask);
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(root, ec);
+             !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+            if (it->is_directory())
+                inotify_add_watch(inotify.get(), it->path().c_str(), mask);
+    };
+    add_watches();
+
+    alignas(inotify_event) char buf[4096];
+    while (watching) {
+        pollfd pfd{inotify.get(), POLLIN, 0};
+        if (poll(&pfd, 1, 500) <= 0)
+            continue;
+
+        bool changed = false;
+        while (read(inotify.get(), buf, sizeof(buf)) > 0)
+            changed = true;
+
+        if (changed) {
+            add_watches();
+            load();
+            std::cout << "Reloaded " << size() << " static assets from " << root << "\n";
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#include "http/timer_wheel.h"
+#include <algorithm>
+#include <bit>
+
+void TimerWheel::Timer::cancel() {
+    prev->next = next;
+    next->prev = prev;
+    prev = next = this;
+}
+
+void TimerWheel::Timer::link_before(Timer& head) {
+    prev = head.prev;
+    next = &head;
+    head.prev->next = this;
+    head.prev = this;
+}
+
+TimerWheel::TimerWheel(Clock::duration tick, size_t slots, Clock::time_point origin)
+    : tick(tick), origin(origin), wheel(std::bit_ceil(slots < 2 ? size_t{2} : slots)) {
+}
+
+uint64_t TimerWheel::tick_of(Clock::time_point time) const {
+    if (time <= origin)
+        return 0;
+    return static_cast<uint64_t>((time - origin + tick - Clock::duration(1)) / tick);
+}
+
+void TimerWheel::schedule(Timer& timer, Clock::time_point deadline) {
+    timer.cancel();
+    // Never into a slot advance() has already passed; that would cost a full turn.
+    timer.expires = std::max(tick_of(deadline), current + 1);
+    timer.link_before(wheel[timer.expires & (wheel.size() - 1)]);
+}
+
+size_t TimerWheel::advance(Clock::time_point now, const std::function<void(Timer&)>& expired) {
+    uint64_t target = now <= origin ? 0 : static_cast<uint64_t>((now - origin) / tick);
+    if (target <= current)
+        return 0;
+
+    // Expired timers move to a private list first, so callbacks that re-arm or destroy
+    // timers never touch a slot that is being walked.
+    Timer due;
+    uint64_t steps = std::min<uint64_t>(target - current, wheel.size());
+    for (uint64_t t = target - steps + 1; t <= target; ++t) {
+        Timer& head = wheel[t & (wheel.size() - 1)];
+        for (Timer* timer = head.next; timer != &head;) {
+            Timer* next = timer->next;
+            if (timer->expires <= target) {
+                timer->cancel();
+                timer->link_before(due);
+            }
+            timer = next;
+        }
+    }
+    current = target;
+
+    size_t fired = 0;
+    while (due.armed()) {
+        Timer& timer = *due.next;
+        timer.cancel();
+        expired(timer);
+        ++fired;
+    }
+    return fired;
+}
+
+TimerWheel::Clock::duration TimerWheel::tick_length() const {
+    return tick;
+}
@@ -0,0 +1,109 @@
+#include "http/worker_pool.h"
+#include <algorithm>
+#include <iostream>
+
+WorkerPool::WorkerPool(size_t threads, size_t capacity) {
+    if (threads == 0)
+        threads = std::max(2u, std::thread::hardware_concurrency());
+    max_queued = capacity == 0 ? threads * 16 : capacity;
+
+    for (size_t i = 0; i < threads; ++i)
+        queues.push_back(std::make_unique<Queue>());
+    for (size_t i = 0; i < threads; ++i)
+        workers.emplace_back(&WorkerPool::run, this, i);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard lock(wake_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+bool WorkerPool::try_submit(Task task) {
+    if (depth.fetch_add(1, std::memory_order_acq_rel) >= max_queued) {
+        depth.fetch_sub(1, std::memory_order_acq_rel);
+        rejected_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Queue& queue = *queues[next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        // Taking the lock orders this notify after a worker's predicate check.
+        std::lock_guard lock(wake_mutex);
+    }
+    wake.notify_one();
+    return true;
+}
+
+bool WorkerPool::pop(size_t index, Task& task) {
+    {
+        Queue& own = *queues[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < queues.size(); ++i) {
+        Queue& victim = *queues[(index + i) % queues.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::run(size_t index) {
+    Task task;
+    for (;;) {
+        if (pop(index, task)) {
+            depth.fetch_sub(1, std::memory_order_acq_rel);
+            try {
+                task();
+            } catch (const std::exception& e) {
+                std::cerr << "Worker task failed: " << e.what() << "\n";
+            }
+            task = nullptr;
+            completed_count.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        std::unique_lock lock(wake_mutex);
+        wake.wait(lock, [this] { return stopping || depth.load(std::memory_order_acquire) > 0; });
+        if (stopping && depth.load(std::memory_order_acquire) == 0)
+            return;
+    }
+}
+
+size_t WorkerPool::size() const {
+    return workers.size();
+}
+
+size_t WorkerPool::capacity() const {
+    return max_queued;
+}
+
+size_t WorkerPool::queue_depth() const {
+    return depth.load(std::memory_order_relaxed);
+}
+
+uint64_t WorkerPool::rejected() const {
+    return rejected_count.load(std::memory_order_relaxed);
+}
+
+uint64_t WorkerPool::completed() const {
+    return completed_count.load(std::memory_order_relaxed);
+}
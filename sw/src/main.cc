@@ -1,53 +1,93 @@
 #include "clock/clock.h"
+#include "helpers/http_client.h"
+#include "helpers/iso_time.h"
+#include "helpers/metrics.h"
+#include "helpers/scheduler.h"
 #include "http/http_server.h"
 #include "transport/departure_group.h"
 #include "weather/weather.h"
+#include <cstdlib>
 #include <filesystem>
-#include <fstream>
+#include <iostream>
+#include <tuple>
 #include <nlohmann/json.hpp>
-#include <sstream>
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 
 int main() {
+    HttpServerOptions server_options; // stamps the startup time the server reports against
+
+    constexpr double latitude = 59.34297;
+    constexpr double longitude = 17.98466;
+
     Weather weather;
     ClockState clock;
-
-    weather.update_from_json(weather.fetch_weather_json(59.34297, 17.98466));
-    clock.update();
+    HttpClient& upstream = HttpClient::shared();
 
     DepartureGroup huv_tc("Huvudsta", "T-Centralen");
     DepartureGroup huv_kis("Huvudsta", "Kista");
     DepartureGroup huv_kth("Huvudsta", "Tekniska Högskolan");
+    std::vector<DepartureGroup*> groups{&huv_tc, &huv_kis, &huv_kth};
+
+    // Upstreams can be pointed elsewhere, e.g. at smart_mirror_replay for offline testing:
+    // SMART_MIRROR_SMHI_URL=http://127.0.0.1:9090 SMART_MIRROR_SL_URL=http://127.0.0.1:9090
+    if (const char* url = std::getenv("SMART_MIRROR_SMHI_URL"))
+        weather.set_base_url(url);
+    if (const char* url = std::getenv("SMART_MIRROR_SL_URL"))
+        for (auto* group : groups)
+            group->set_base_url(url);
+
+    fs::path root = fs::current_path();
+    if (root.filename() == "build")
+        root = root.parent_path();
+
+    // Start from the last good data on disk rather than waiting for upstream; the first
+    // refresh runs in the background as soon as the scheduler starts.
+    fs::path cache_dir = root / "cache";
+    fs::path weather_cache = cache_dir / "forecast.bin";
+    fs::path departures_cache = cache_dir / "departures.bin";
+    bool cached_forecast = weather.load(weather_cache);
+    bool cached_departures = DepartureGroup::load_all(groups, departures_cache);
+    std::cout << "Startup cache " << cache_dir << ": forecast "
+              << (cached_forecast ? "loaded" : "missing") << ", departures "
+              << (cached_departures ? "loaded" : "missing") << "\n";
+    clock.update();
+
+    StaticAssets assets(root / "frontend");
+    assets.watch();
 
-    huv_tc.update();
-    huv_kis.update();
-    huv_kth.update();
+    EventStream events;
+    HttpServer server(8080, server_options);
 
-    HttpServer server(8080);
+    // The dynamic endpoints are rendered once per data version, not once per poll. Versions
+    // only ever grow, so a sum changes whenever any of its sources does.
+    ResponseCache responses;
 
-    server.add_route("/clock", [&]() {
-        json j{{"current_date", clock.get_current_date()},
-               {"current_day", clock.get_current_day()},
-               {"current_time", clock.get_current_time()},
-               {"week_number", clock.get_week_number()}};
+    responses.add("/clock", [&]() { return clock.version(); }, [&]() {
+        auto now = clock.snapshot();
+        json j{{"current_date", now->date},
+               {"current_day", now->day},
+               {"current_time", now->time},
+               {"week_number", now->week_number}};
         return std::make_pair(j.dump(), "application/json");
     });
 
-    server.add_route("/weather", [&]() {
+    responses.add("/weather", [&]() { return weather.version() + clock.version(); }, [&]() {
+        auto today = clock.snapshot()->today;
+        auto forecast = weather.forecast();
         json j;
-        if (auto t = weather.get_today(clock.get_current_date())) {
-            j["today"] = {{"date", t->date},
+        if (auto t = weather.get_today(today)) {
+            j["today"] = {{"date", format_iso_date(t->date)},
                           {"min_temp", t->min_temperature},
                           {"max_temp", t->max_temperature},
                           {"avg_wind", t->avg_wind_speed},
                           {"weather_code", t->most_common_weather_code}};
         }
         json arr = json::array();
-        for (auto& d : weather.get_daily_forecast())
-            if (d.date != clock.get_current_date())
-                arr.push_back({{"date", d.date},
+        for (auto& d : forecast->daily)
+            if (d.date != today)
+                arr.push_back({{"date", format_iso_date(d.date)},
                                {"min_temp", d.min_temperature},
                                {"max_temp", d.max_temperature},
                                {"avg_wind", d.avg_wind_speed},
@@ -56,91 +96,136 @@ int main() {
         return std::make_pair(j.dump(), "application/json");
     });
 
-    server.add_route("/departures", [&]() {
-        huv_tc.update();
-        huv_kis.update();
-        huv_kth.update();
+    auto departures_version = [&]() {
+        uint64_t sum = clock.version(); // minutes are relative to the clock
+        for (auto* group : groups)
+            sum += group->version();
+        return sum;
+    };
 
-        auto pack = [](const DepartureGroup& g) {
-            json a = json::array();
-            for (auto& s : g.display(5))
-                a.push_back(s);
-            return a;
-        };
+    // Minutes are worked out at render time against the wall clock, so the boards keep
+    // counting down between refreshes. The clock's version moves once a minute, which
+    // re-renders /departures on the minute.
+    auto pack = [](const DepartureGroup& g, std::chrono::sys_seconds now) {
+        json a = json::array();
+        for (const auto& d : g.upcoming(now, 5)) {
+            json transfers = json::array();
+            for (const auto& t : d.transfers)
+                transfers.push_back({{"line", t.line}, {"direction", t.direction}});
+            json entry{{"from", d.from},
+                       {"to", d.to},
+                       {"line", d.line},
+                       {"direction", d.direction},
+                       {"departure", format_iso_datetime(d.departure_time())},
+                       {"planned_departure", format_iso_datetime(d.planned_departure)},
+                       {"minutes", Departure::minutes_until(d.departure_time(), now)},
+                       {"transfers", transfers},
+                       {"delayed", d.delayed}};
+            if (auto arrival = d.arrival_time()) {
+                entry["arrival"] = format_iso_datetime(*arrival);
+                entry["arrival_minutes"] = Departure::minutes_until(*arrival, now);
+            }
+            a.push_back(std::move(entry));
+        }
+        return a;
+    };
+    auto now_seconds = []() {
+        return std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+    };
 
-        json j = json::array();
-        j.push_back({{"name", "Huvudsta - Kista"}, {"departures", pack(huv_kis)}});
-        j.push_back({{"name", "Huvudsta - T-Centralen"}, {"departures", pack(huv_tc)}});
-        j.push_back({{"name", "Huvudsta - KTH"}, {"departures", pack(huv_kth)}});
+    // Display name and URL slug of each group, in the order the page lists them.
+    const std::vector<std::tuple<std::string, std::string, const DepartureGroup*>> boards{
+        {"kista", "Huvudsta - Kista", &huv_kis},
+        {"t-centralen", "Huvudsta - T-Centralen", &huv_tc},
+        {"kth", "Huvudsta - KTH", &huv_kth}};
 
+    responses.add("/departures", departures_version, [&]() {
+        auto now = now_seconds();
+        json j = json::array();
+        for (const auto& [slug, name, group] : boards)
+            j.push_back({{"name", name}, {"departures", pack(*group, now)}});
         return std::make_pair(j.dump(), "application/json");
     });
 
-    server.add_route("/", [&]() {
-        namespace fs = std::filesystem;
-
-        fs::path root = fs::current_path();
-
-        if (root.filename() == "build") {
-            root = root.parent_path();
-        }
-
-        fs::path index = root / "frontend" / "index.html";
-
-        std::ifstream file(index);
-        if (!file) {
-            return std::make_pair("<h1>index.html not found</h1><pre>" + index.string() + "</pre>",
-                                  "text/html");
-        }
-
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        return std::make_pair(buffer.str(), "text/html");
+    server.add_route("GET", "/departures/{group}", [&](const RouteParams& params) {
+        for (const auto& [slug, name, group] : boards)
+            if (slug == params.get("group")) {
+                json j{{"name", name}, {"departures", pack(*group, now_seconds())}};
+                return std::make_pair(j.dump(), "application/json");
+            }
+        throw RouteNotFound("unknown departure group");
     });
 
-    server.add_route("/style.css", []() -> std::pair<std::string, std::string> {
-        std::ifstream file("frontend/style.css");
-        if (!file)
-            return {"File not found", "text/css"};
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        return {buffer.str(), "text/css"};
+    server.add_route("/stats", [&]() {
+        const auto& pool = server.workers();
+        json j{{"workers", pool.size()},
+               {"queue_capacity", pool.capacity()},
+               {"queue_depth", pool.queue_depth()},
+               {"rejected", pool.rejected()},
+               {"completed", pool.completed()},
+               {"first_byte_ms", server.time_to_first_byte()}};
+        return std::make_pair(j.dump(), "application/json");
     });
 
-    server.add_route("/app.js", []() -> std::pair<std::string, std::string> {
-        std::ifstream file("frontend/app.js");
-        if (!file)
-            return {"File not found", "application/javascript"};
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        return {buffer.str(), "application/javascript"};
+    // Seconds since each upstream snapshot was last replaced, read at scrape time.
+    auto& metrics = Metrics::global();
+    auto age = [](std::chrono::steady_clock::time_point updated) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - updated).count();
+    };
+    metrics.gauge("smart_mirror_snapshot_age_seconds", "Time since the data was last replaced.",
+                  {{"source", "smhi"}}, [&]() { return age(weather.updated_at()); });
+    for (const auto& [slug, name, group] : boards)
+        metrics.gauge("smart_mirror_snapshot_age_seconds", "Time since the data was last replaced.",
+                      {{"source", "sl"}, {"group", slug}},
+                      [&age, group]() { return age(group->updated_at()); });
+
+    server.add_route("/metrics", [&]() {
+        return std::make_pair(metrics.render(), "text/plain; version=0.0.4");
     });
 
-    auto get_content_type = [](const fs::path& file_path) {
-        std::string ext = file_path.extension().string();
-        if (ext == ".svg")
-            return "image/svg+xml";
-        if (ext == ".ico")
-            return "image/x-icon";
-        return "application/octet-stream";
-    };
+    RefreshScheduler scheduler;
+    scheduler.add_task("clock", std::chrono::seconds(1), [&]() {
+        clock.update();
+        responses.refresh();
+    });
+    scheduler.add_task(
+        "departures", std::chrono::seconds(60),
+        [&]() {
+            // A 304 counts as a good answer but publishes nothing; only rewrite the cache,
+            // and wear the card, when some group's list was actually replaced.
+            auto versions = [&]() {
+                uint64_t sum = 0;
+                for (auto* group : groups)
+                    sum += group->version();
+                return sum;
+            };
+            uint64_t before = versions();
+            DepartureGroup::update_all(groups, upstream);
+            if (versions() != before)
+                DepartureGroup::save_all(groups, departures_cache);
+            responses.refresh();
+        },
+        true);
+    scheduler.add_task(
+        "weather", std::chrono::minutes(10),
+        [&]() {
+            auto url = weather.forecast_url(latitude, longitude);
+            if (weather.apply_response(upstream.revalidate(url).get()))
+                weather.save(weather_cache);
+            responses.refresh();
+        },
+        true);
+
+    // Pages subscribe to /events instead of polling; each endpoint's JSON is pushed under
+    // its own event name whenever its bytes change.
+    responses.on_change([&](const std::string& path, const CachedResponse& response) {
+        events.publish(std::string_view(path).substr(1), response.body);
+    });
 
-    fs::path icons_dir = "frontend/icons";
-    for (auto& entry : fs::directory_iterator(icons_dir)) {
-        if (entry.is_regular_file()) {
-            fs::path file_path = entry.path();
-            std::string route = "/icons/" + file_path.filename().string();
-            std::string type = get_content_type(file_path);
-
-            server.add_route(route, [file_path, type]() -> std::pair<std::string, std::string> {
-                std::ifstream file(file_path, std::ios::binary);
-                if (!file)
-                    return {"File not found: " + file_path.string(), "text/plain"};
-                std::stringstream buffer;
-                buffer << file.rdbuf();
-                return {buffer.str(), type};
-            });
-        }
-    }
+    responses.refresh();
+    server.add_cached(responses);
+    server.add_events("/events", events);
+    server.add_static(assets);
+    scheduler.start();
     server.start();
 }
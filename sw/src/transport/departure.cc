@@ -1,63 +1,37 @@
 #include "transport/departure.h"
-#include <sstream>
 #include <string>
 
-Departure::Departure(const std::string& dest, int mins, const std::string& info, bool del)
-    : destination(dest), minutes_until(mins), transfer_info(info), delayed(del) {
+std::chrono::sys_seconds Departure::departure_time() const {
+    return estimated_departure.value_or(planned_departure);
 }
 
-void Departure::set_destination(const std::string& dest) {
-    destination = dest;
+std::optional<std::chrono::sys_seconds> Departure::arrival_time() const {
+    return estimated_arrival ? estimated_arrival : planned_arrival;
 }
 
-void Departure::set_minutes_until(int mins) {
-    minutes_until = mins;
+int Departure::minutes_until(std::chrono::sys_seconds time, std::chrono::sys_seconds now) {
+    return static_cast<int>(std::chrono::floor<std::chrono::minutes>(time - now).count());
 }
 
-void Departure::set_delayed(bool del) {
-    delayed = del;
-}
+std::string Departure::display(std::chrono::sys_seconds now) const {
+    std::string text = from + " - " + to;
 
-void Departure::set_arrival_minutes(int total_time) {
-    arrival_minutes = total_time;
-}
+    int minutes = minutes_until(departure_time(), now);
+    if (minutes == 0)
+        text += " | Avgår nu";
+    else if (minutes > 0)
+        text += " | Avgår om " + std::to_string(minutes) + " min";
 
-std::string Departure::display() const {
-    std::ostringstream oss;
-    oss << destination;
+    if (auto arrival = arrival_time(); arrival && *arrival >= now)
+        text += " | Ankomsttid " + std::to_string(minutes_until(*arrival, now)) + " min";
 
-    if (minutes_until >= 0) {
-        oss << " | ";
-        if (minutes_until == 0)
-            oss << "Avgår nu";
-        else
-            oss << "Avgår om " + std::to_string(minutes_until) + " min";
+    for (const auto& transfer : transfers) {
+        text += " | Byt till " + transfer.line;
+        if (!transfer.direction.empty())
+            text += " mot " + transfer.direction;
     }
 
-    if (arrival_minutes >= 0)
-        oss << " | Ankomsttid " + std::to_string(arrival_minutes) + " min";
-
-    if (!transfer_info.empty())
-        oss << " | " + transfer_info;
-
     if (delayed)
-        oss << " | Delayed";
-
-    return oss.str();
-}
-
-int Departure::get_minutes_until() const {
-    return minutes_until;
-}
-
-void Departure::set_transfer_info(const std::string& info) {
-    transfer_info = info;
-}
-
-std::string Departure::get_route_summary() const {
-    return route_summary;
-}
-
-std::string Departure::get_destination_station() const {
-    return destination_station;
+        text += " | Delayed";
+    return text;
 }
@@ -1,7 +1,12 @@
 #include "transport/departure_group.h"
-#include "helpers/helper.h"
+#include "helpers/disk_cache.h"
+#include "helpers/http_client.h"
+#include "helpers/iso_time.h"
+#include "helpers/metrics.h"
+#include <algorithm>
 #include <cctype>
 #include <format>
+#include <future>
 #include <iostream>
 #include <string>
 
@@ -26,30 +31,29 @@ std::pair<std::string, std::string> DepartureGroup::get_station_ids() const {
     return {it_from->second, it_to->second};
 }
 
+void DepartureGroup::set_base_url(std::string url) {
+    base_url = std::move(url);
+}
+
 std::string DepartureGroup::build_url(const std::string& from_id, const std::string& to_id) const {
-    return std::format("https://journeyplanner.integration.sl.se/v2/trips?"
-                       "type_origin=any&name_origin={}&type_destination=any&name_"
-                       "destination={}&calc_number_of_trips=3",
-                       from_id, to_id);
+    return std::format("{}/v2/trips?type_origin=any&name_origin={}&type_destination=any&name_"
+                       "destination={}&calc_number_of_trips=6",
+                       base_url, from_id, to_id);
 }
 
-std::vector<std::string> DepartureGroup::display(size_t n) const {
-    std::vector<std::string> result;
-    for (size_t i = 0; i < departures.size() && i < n; ++i) {
-        result.push_back(departures[i].display());
+std::vector<Departure> DepartureGroup::upcoming(std::chrono::sys_seconds now, size_t n) const {
+    auto snapshot = departures.load();
+    std::vector<Departure> result;
+    for (const auto& d : *snapshot) {
+        if (result.size() == n)
+            break;
+        if (Departure::minutes_until(d.departure_time(), now) >= 0)
+            result.push_back(d);
     }
     return result;
 }
 
 Departure DepartureGroup::parse_journey(const nlohmann::json& journey) const {
-    Departure d;
-    int start_minutes = -1;
-    int arrival_minutes = -1;
-    bool delayed = false;
-    std::string route_summary = from;
-    std::vector<std::string> transfers;
-
-    const auto& legs = journey["legs"];
     auto clean_station_name = [](const std::string& name) {
         auto pos = name.find(',');
         return (pos != std::string::npos) ? name.substr(0, pos) : name;
@@ -60,95 +64,257 @@ Departure DepartureGroup::parse_journey(const nlohmann::json& journey) const {
             return name.substr(prefix.size());
         return name;
     };
+    auto time_of = [](const nlohmann::json& stop,
+                      const char* key) -> std::optional<std::chrono::sys_seconds> {
+        auto it = stop.find(key);
+        if (it == stop.end() || !it->is_string())
+            return std::nullopt;
+        return parse_iso_datetime(it->get_ref<const std::string&>());
+    };
+    // Line name and terminus of a leg, if it is a ride rather than a walk.
+    auto ride_of = [&](const nlohmann::json& leg) -> std::optional<DepartureTransfer> {
+        if (!leg.contains("transportation") || !leg["transportation"].contains("name"))
+            return std::nullopt;
+        const auto& transportation = leg["transportation"];
+        DepartureTransfer ride{clean_transport_name(transportation["name"].get<std::string>()),
+                               {}};
+        if (transportation.contains("destination") &&
+            transportation["destination"].contains("name"))
+            ride.direction = transportation["destination"]["name"].get<std::string>();
+        if (ride.line.empty())
+            return std::nullopt;
+        return ride;
+    };
 
+    Departure d;
+    d.from = from;
+    const auto& legs = journey["legs"];
     for (size_t i = 0; i < legs.size(); ++i) {
         const auto& leg = legs[i];
-        std::string dest_name = clean_station_name(leg["destination"]["name"].get<std::string>());
 
         if (i == 0) {
-            std::string dep_time_iso = leg["origin"]["departureTimePlanned"].get<std::string>();
-            start_minutes = parse_minutes(dep_time_iso);
-            route_summary += " - " + dest_name;
-        }
-
-        if (i + 1 < legs.size()) {
-            const auto& next_leg = legs[i + 1];
-            if (next_leg.contains("transportation") &&
-                next_leg["transportation"].contains("name")) {
-                std::string t_name =
-                    clean_transport_name(next_leg["transportation"]["name"].get<std::string>());
-                if (next_leg["transportation"].contains("destination") &&
-                    next_leg["transportation"]["destination"].contains("name")) {
-                    t_name += " mot " +
-                              next_leg["transportation"]["destination"]["name"].get<std::string>();
-                }
-                if (!t_name.empty())
-                    transfers.push_back("Byt till " + t_name);
+            auto planned = time_of(leg["origin"], "departureTimePlanned");
+            if (!planned)
+                throw std::runtime_error("Invalid start time");
+            d.planned_departure = *planned;
+            d.estimated_departure = time_of(leg["origin"], "departureTimeEstimated");
+            d.to = clean_station_name(leg["destination"]["name"].get<std::string>());
+            if (auto ride = ride_of(leg)) {
+                d.line = std::move(ride->line);
+                d.direction = std::move(ride->direction);
             }
+        } else if (auto ride = ride_of(leg)) {
+            d.transfers.push_back(std::move(*ride));
         }
 
         if (leg.contains("realtimeStatus") && !leg["realtimeStatus"].empty()) {
             std::string status = leg["realtimeStatus"][0].get<std::string>();
             if (status != "MONITORED")
-                delayed = true;
+                d.delayed = true;
         }
 
         if (i == legs.size() - 1) {
-            if (leg["destination"].contains("arrivalTimeEstimated"))
-                arrival_minutes =
-                    parse_minutes(leg["destination"]["arrivalTimeEstimated"].get<std::string>());
-            else if (leg["destination"].contains("arrivalTimePlanned"))
-                arrival_minutes =
-                    parse_minutes(leg["destination"]["arrivalTimePlanned"].get<std::string>());
+            d.planned_arrival = time_of(leg["destination"], "arrivalTimePlanned");
+            d.estimated_arrival = time_of(leg["destination"], "arrivalTimeEstimated");
         }
     }
+    return d;
+}
 
-    if (start_minutes < 0)
-        throw std::runtime_error("Invalid start time");
+std::string DepartureGroup::request_url() const {
+    auto [from_id, to_id] = get_station_ids();
+    return build_url(from_id, to_id);
+}
 
-    d.set_destination(route_summary);
-    d.set_minutes_until(start_minutes);
-    d.set_arrival_minutes(arrival_minutes);
-    d.set_delayed(delayed);
+bool DepartureGroup::update(HttpClient& client) {
+    return begin_update(client).get();
+}
 
-    std::ostringstream transfer_text;
-    for (size_t i = 0; i < transfers.size(); ++i) {
-        if (i > 0)
-            transfer_text << " | ";
-        transfer_text << transfers[i];
-    }
-    d.set_transfer_info(transfer_text.str());
+// Concurrent callers share one fetch and parse, and a refresh submitted within the window is
+// reused, so SL sees at most one query per window however many callers there are. The
+// singleflight only covers the submission; the parse is deferred to the first get().
+std::shared_future<bool> DepartureGroup::begin_update(HttpClient& client) {
+    std::string url = request_url();
+    return refreshes.run(url, [&]() {
+        auto response = client.revalidate(url).share();
+        return std::async(std::launch::deferred,
+                          [this, response]() { return apply_response(response.get()); })
+            .share();
+    });
+}
 
-    return d;
+void DepartureGroup::set_refresh_window(std::chrono::milliseconds window) {
+    refreshes.set_fresh_for(window);
+}
+
+// Every group's request is submitted before any is waited on, so they are all in flight on
+// the client's one transfer loop together and a refresh costs one round-trip to the slowest
+// of them. Returns true if every group got a good answer.
+bool DepartureGroup::update_all(const std::vector<DepartureGroup*>& groups, HttpClient& client) {
+    std::vector<std::shared_future<bool>> results;
+    results.reserve(groups.size());
+    for (auto* group : groups)
+        results.push_back(group->begin_update(client));
+    bool all_ok = true;
+    for (auto& result : results)
+        all_ok &= result.get();
+    return all_ok;
 }
 
-void DepartureGroup::update() {
-    departures.clear();
+// Builds the new list off to the side and publishes it in one step, so readers see either
+// the previous list or the new one, never a half-filled vector.
+//
+// Departures carry absolute times, so a 304 means the list held is still exactly right and
+// nothing is re-read. A failed fetch keeps the last good list too; trips that have left
+// drop out when it is shown.
+bool DepartureGroup::apply_response(const HttpResponse& response) {
+    static Histogram& parse_time = Metrics::global().histogram(
+        "smart_mirror_parse_seconds", "Upstream JSON parse time.", {{"source", "sl"}});
 
     try {
-        auto [from_id, to_id] = get_station_ids();
-        std::string url = build_url(from_id, to_id);
-        std::string response = http_get(url);
-        json j = json::parse(response);
-
-        if (!j.contains("journeys"))
-            return;
-
-        for (const auto& journey : j["journeys"]) {
-            if (!journey.contains("legs") || journey["legs"].empty())
-                continue;
-            try {
-                departures.push_back(parse_journey(journey));
-            } catch (...) {
-                continue;
+        if (!response.error.empty())
+            throw std::runtime_error(response.error);
+        if (response.not_modified())
+            return true;
+        if (!response.ok())
+            throw std::runtime_error("HTTP " + std::to_string(response.status));
+        auto start = std::chrono::steady_clock::now();
+        json j = json::parse(response.body);
+
+        std::vector<Departure> fresh;
+        if (j.contains("journeys")) {
+            for (const auto& journey : j["journeys"]) {
+                if (!journey.contains("legs") || journey["legs"].empty())
+                    continue;
+                try {
+                    fresh.push_back(parse_journey(journey));
+                } catch (...) {
+                    continue;
+                }
             }
         }
+        std::stable_sort(fresh.begin(), fresh.end(), [](const Departure& a, const Departure& b) {
+            return a.departure_time() < b.departure_time();
+        });
+        parse_time.record(std::chrono::steady_clock::now() - start);
+        departures.publish(std::move(fresh));
+        return true;
 
     } catch (const std::exception& e) {
         std::cerr << "DepartureGroup update failed: " << e.what() << "\n";
+        if (response.ok())
+            response.reject(); // fetched but unparseable
+        return false;
     }
 }
 
+namespace {
+
+constexpr uint32_t departures_cache_format = 2;
+
+void write_time(BinaryWriter& out, std::optional<std::chrono::sys_seconds> time) {
+    out.u8(time.has_value());
+    out.i64(time ? time->time_since_epoch().count() : 0);
+}
+
+bool read_time(BinaryReader& in, std::optional<std::chrono::sys_seconds>& time) {
+    uint8_t present;
+    int64_t seconds;
+    if (!in.u8(present) || !in.i64(seconds))
+        return false;
+    time.reset();
+    if (present)
+        time = std::chrono::sys_seconds(std::chrono::seconds(seconds));
+    return true;
+}
+
+} // namespace
+
+bool DepartureGroup::save_all(const std::vector<DepartureGroup*>& groups,
+                              const std::filesystem::path& path) {
+    BinaryWriter out;
+    out.u32(static_cast<uint32_t>(groups.size()));
+    for (const auto* group : groups) {
+        auto snapshot = group->departures.load();
+        out.str(group->get_name());
+        out.u32(static_cast<uint32_t>(snapshot->size()));
+        for (const auto& d : *snapshot) {
+            out.str(d.from);
+            out.str(d.to);
+            out.str(d.line);
+            out.str(d.direction);
+            write_time(out, d.planned_departure);
+            write_time(out, d.estimated_departure);
+            write_time(out, d.planned_arrival);
+            write_time(out, d.estimated_arrival);
+            out.u32(static_cast<uint32_t>(d.transfers.size()));
+            for (const auto& transfer : d.transfers) {
+                out.str(transfer.line);
+                out.str(transfer.direction);
+            }
+            out.u8(d.delayed);
+        }
+    }
+    return save_cache(path, departures_cache_format, out.data());
+}
+
+bool DepartureGroup::load_all(const std::vector<DepartureGroup*>& groups,
+                              const std::filesystem::path& path) {
+    auto record = load_cache(path, departures_cache_format);
+    if (!record)
+        return false;
+
+    auto now = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+    BinaryReader in(record->payload);
+    std::map<std::string, std::vector<Departure>> restored;
+    uint32_t group_count;
+    if (!in.u32(group_count))
+        return false;
+    for (uint32_t g = 0; g < group_count; ++g) {
+        std::string name;
+        uint32_t count;
+        if (!in.str(name) || !in.u32(count) || count > record->payload.size())
+            return false;
+        auto& list = restored[name];
+        for (uint32_t i = 0; i < count; ++i) {
+            Departure d;
+            std::optional<std::chrono::sys_seconds> planned;
+            uint32_t transfers;
+            if (!in.str(d.from) || !in.str(d.to) || !in.str(d.line) || !in.str(d.direction) ||
+                !read_time(in, planned) || !planned || !read_time(in, d.estimated_departure) ||
+                !read_time(in, d.planned_arrival) || !read_time(in, d.estimated_arrival) ||
+                !in.u32(transfers) || transfers > record->payload.size())
+                return false;
+            d.planned_departure = *planned;
+            d.transfers.resize(transfers);
+            for (auto& transfer : d.transfers)
+                if (!in.str(transfer.line) || !in.str(transfer.direction))
+                    return false;
+            uint8_t delayed;
+            if (!in.u8(delayed))
+                return false;
+            d.delayed = delayed != 0;
+            if (Departure::minutes_until(d.departure_time(), now) >= 0)
+                list.push_back(std::move(d));
+        }
+    }
+    if (!in.done())
+        return false;
+
+    for (auto* group : groups)
+        if (auto it = restored.find(group->get_name()); it != restored.end())
+            group->departures.publish(std::move(it->second));
+    return true;
+}
+
 std::string DepartureGroup::get_name() const {
     return from + " - " + to;
 }
+
+uint64_t DepartureGroup::version() const {
+    return departures.version();
+}
+
+std::chrono::steady_clock::time_point DepartureGroup::updated_at() const {
+    return departures.published_at();
+}
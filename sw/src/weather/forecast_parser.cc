@@ -0,0 +1,222 @@
+#include "weather/forecast_parser.h"
+#include "helpers/iso_time.h"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace {
+
+class ForecastSax : public nlohmann::json_sax<json> {
+public:
+    explicit ForecastSax(Forecast& out) : out(out) {
+    }
+
+    bool null() override {
+        return true;
+    }
+    bool boolean(bool) override {
+        return true;
+    }
+    bool number_integer(number_integer_t val) override {
+        return number(static_cast<double>(val));
+    }
+    bool number_unsigned(number_unsigned_t val) override {
+        return number(static_cast<double>(val));
+    }
+    bool number_float(number_float_t val, const string_t&) override {
+        return number(val);
+    }
+    bool binary(binary_t&) override {
+        return true;
+    }
+
+    bool string(string_t& val) override {
+        if (depth == 1 && last_key == Key::ApprovedTime)
+            out.approved_time = std::move(val);
+        else if (depth == entry_depth && last_key == Key::ValidTime)
+            return valid_time(val);
+        else if (depth == parameter_depth && last_key == Key::Name)
+            parameter = classify(val);
+        return true;
+    }
+
+    bool key(string_t& val) override {
+        last_key = Key::Other;
+        if (depth == 1 && val == "timeSeries")
+            last_key = Key::TimeSeries;
+        else if (depth == 1 && val == "approvedTime")
+            last_key = Key::ApprovedTime;
+        else if (depth == entry_depth && val == "validTime")
+            last_key = Key::ValidTime;
+        else if (depth == entry_depth && val == "parameters")
+            last_key = Key::Parameters;
+        else if (depth == parameter_depth && val == "name")
+            last_key = Key::Name;
+        else if (depth == parameter_depth && val == "values")
+            last_key = Key::Values;
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        ++depth;
+        if (in_series && depth == entry_depth) {
+            hour = HourlyForecast{};
+            has_valid_time = false;
+        }
+        if (in_parameters && depth == parameter_depth) {
+            parameter = Parameter::Other;
+            has_value = false;
+        }
+        return true;
+    }
+
+    bool end_object() override {
+        if (in_parameters && depth == parameter_depth && has_value)
+            apply_parameter();
+        if (in_series && depth == entry_depth) {
+            if (!has_valid_time) {
+                error = "time step without validTime";
+                return false;
+            }
+            out.hourly.push_back(hour);
+        }
+        --depth;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        ++depth;
+        if (depth == 2 && last_key == Key::TimeSeries)
+            in_series = true;
+        else if (in_series && depth == entry_depth + 1 && last_key == Key::Parameters)
+            in_parameters = true;
+        else if (in_parameters && depth == parameter_depth + 1 && last_key == Key::Values)
+            in_values = true;
+        return true;
+    }
+
+    bool end_array() override {
+        if (depth == 2)
+            in_series = false;
+        else if (depth == entry_depth + 1)
+            in_parameters = false;
+        else if (depth == parameter_depth + 1)
+            in_values = false;
+        --depth;
+        last_key = Key::Other;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&,
+                     const nlohmann::detail::exception& ex) override {
+        error = ex.what();
+        return false;
+    }
+
+    void finish() {
+        out.hourly.sort();
+        out.daily = aggregate_daily(out.hourly);
+    }
+
+    std::string error;
+
+private:
+    // Nesting depth of the interesting containers: root {} > timeSeries [] > entry {} >
+    // parameters [] > parameter {} > values [].
+    static constexpr int entry_depth = 3;
+    static constexpr int parameter_depth = 5;
+
+    enum class Key { Other, ApprovedTime, TimeSeries, ValidTime, Parameters, Name, Values };
+    enum class Parameter { Other, Temperature, WindSpeed, WeatherSymbol };
+
+    Forecast& out;
+    HourlyForecast hour;
+    bool has_valid_time = false;
+
+    int depth = 0;
+    Key last_key = Key::Other;
+    bool in_series = false;
+    bool in_parameters = false;
+    bool in_values = false;
+
+    Parameter parameter = Parameter::Other;
+    double value = 0.0;
+    bool has_value = false;
+
+    static Parameter classify(std::string_view name) {
+        if (name == "t")
+            return Parameter::Temperature;
+        if (name == "ws")
+            return Parameter::WindSpeed;
+        if (name == "Wsymb2")
+            return Parameter::WeatherSymbol;
+        return Parameter::Other;
+    }
+
+    // A time step the series cannot be placed in fails the whole parse, so the last good
+    // forecast stays up instead of gaining an hour at the epoch.
+    bool valid_time(std::string_view text) {
+        auto time = parse_iso_datetime(text);
+        if (!time) {
+            error = "bad validTime: " + std::string(text);
+            return false;
+        }
+        hour.valid_time = *time;
+        has_valid_time = true;
+        return true;
+    }
+
+    // Only the first element of "values" counts, and "name" may follow "values", so the
+    // number is held until the parameter object closes.
+    bool number(double val) {
+        if (in_values && depth == parameter_depth + 1 && !has_value) {
+            value = val;
+            has_value = true;
+        }
+        return true;
+    }
+
+    void apply_parameter() {
+        switch (parameter) {
+        case Parameter::Temperature:
+            hour.temperature = static_cast<float>(value);
+            break;
+        case Parameter::WindSpeed:
+            hour.wind_speed = static_cast<float>(value);
+            break;
+        case Parameter::WeatherSymbol:
+            hour.weather_code = static_cast<int>(value);
+            break;
+        case Parameter::Other:
+            break;
+        }
+    }
+};
+
+} // namespace
+
+bool parse_forecast(std::string_view json_data, Forecast& out, std::string& error) {
+    Forecast parsed;
+    ForecastSax sax(parsed);
+    if (!json::sax_parse(json_data.begin(), json_data.end(), &sax)) {
+        error = sax.error.empty() ? "unexpected JSON structure" : sax.error;
+        return false;
+    }
+    sax.finish();
+    out = std::move(parsed);
+    return true;
+}
+
+std::string_view peek_approved_time(std::string_view json_data) {
+    constexpr std::string_view key = "\"approvedTime\"";
+    size_t pos = json_data.find(key);
+    if (pos == std::string_view::npos)
+        return {};
+    size_t open = json_data.find('"', json_data.find(':', pos + key.size()));
+    if (open == std::string_view::npos)
+        return {};
+    size_t close = json_data.find('"', open + 1);
+    if (close == std::string_view::npos)
+        return {};
+    return json_data.substr(open + 1, close - open - 1);
+}
@@ -0,0 +1,173 @@
+#include "weather/forecast_store.h"
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+using namespace std::chrono;
+
+void HourlySeries::reserve(size_t n) {
+    time.reserve(n);
+    temperature.reserve(n);
+    wind_speed.reserve(n);
+    weather_code.reserve(n);
+}
+
+void HourlySeries::push_back(const HourlyForecast& hour) {
+    time.push_back(hour.valid_time);
+    temperature.push_back(hour.temperature);
+    wind_speed.push_back(hour.wind_speed);
+    weather_code.push_back(static_cast<uint8_t>(std::clamp(hour.weather_code, 0, 255)));
+}
+
+void HourlySeries::clear() {
+    time.clear();
+    temperature.clear();
+    wind_speed.clear();
+    weather_code.clear();
+}
+
+void HourlySeries::sort() {
+    if (std::is_sorted(time.begin(), time.end()))
+        return;
+
+    std::vector<size_t> order(time.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [this](size_t a, size_t b) { return time[a] < time[b]; });
+
+    HourlySeries sorted;
+    sorted.reserve(order.size());
+    for (size_t i : order)
+        sorted.push_back(at(i));
+    *this = std::move(sorted);
+}
+
+size_t HourlySeries::size() const {
+    return time.size();
+}
+
+bool HourlySeries::empty() const {
+    return time.empty();
+}
+
+HourlyForecast HourlySeries::at(size_t i) const {
+    HourlyForecast hour;
+    hour.valid_time = time[i];
+    hour.temperature = temperature[i];
+    hour.wind_speed = wind_speed[i];
+    hour.weather_code = weather_code[i];
+    return hour;
+}
+
+size_t HourlySeries::lower_bound(sys_seconds t) const {
+    return std::lower_bound(time.begin(), time.end(), t) - time.begin();
+}
+
+HourlySeries::Range HourlySeries::between(sys_seconds from, sys_seconds to) const {
+    size_t first = lower_bound(from);
+    return {first, std::max(first, lower_bound(to))};
+}
+
+HourlySeries::Range HourlySeries::next(sys_seconds t, size_t n) const {
+    size_t first = lower_bound(t);
+    return {first, first + std::min(n, time.size() - first)};
+}
+
+HourlySeries::Range HourlySeries::on(year_month_day day) const {
+    sys_days start(day);
+    return between(start, start + days(1));
+}
+
+const std::vector<sys_seconds>& HourlySeries::times() const {
+    return time;
+}
+
+const std::vector<float>& HourlySeries::temperatures() const {
+    return temperature;
+}
+
+const std::vector<float>& HourlySeries::wind_speeds() const {
+    return wind_speed;
+}
+
+const std::vector<uint8_t>& HourlySeries::weather_codes() const {
+    return weather_code;
+}
+
+namespace {
+
+// Independent accumulators per lane keep the loop free of a serial dependency chain, so it
+// vectorizes without -ffast-math; the lanes are folded together at the end.
+constexpr size_t lanes = 8;
+
+struct ColumnSummary {
+    float min;
+    float max;
+    float sum;
+};
+
+ColumnSummary summarize(const float* values, size_t n) {
+    std::array<float, lanes> lo, hi, sum{};
+    lo.fill(values[0]);
+    hi.fill(values[0]);
+
+    size_t i = 0;
+    for (; i + lanes <= n; i += lanes)
+        for (size_t l = 0; l < lanes; ++l) {
+            float v = values[i + l];
+            lo[l] = v < lo[l] ? v : lo[l];
+            hi[l] = v > hi[l] ? v : hi[l];
+            sum[l] += v;
+        }
+    for (size_t l = 0; i < n; ++i, ++l) {
+        float v = values[i];
+        lo[l] = v < lo[l] ? v : lo[l];
+        hi[l] = v > hi[l] ? v : hi[l];
+        sum[l] += v;
+    }
+
+    ColumnSummary out{lo[0], hi[0], 0.0f};
+    for (size_t l = 0; l < lanes; ++l) {
+        out.min = std::min(out.min, lo[l]);
+        out.max = std::max(out.max, hi[l]);
+        out.sum += sum[l];
+    }
+    return out;
+}
+
+int most_common_code(const uint8_t* codes, size_t n) {
+    std::array<uint16_t, 32> histogram{}; // Wsymb2 codes are 1..27
+    for (size_t i = 0; i < n; ++i)
+        histogram[codes[i] < histogram.size() ? codes[i] : 0]++;
+    return static_cast<int>(std::max_element(histogram.begin(), histogram.end()) -
+                            histogram.begin());
+}
+
+} // namespace
+
+std::vector<ForecastDay> aggregate_daily(const HourlySeries& hourly) {
+    std::vector<ForecastDay> days_out;
+    const auto& times = hourly.times();
+
+    // Rows are time-ordered, so each day is one contiguous run found by binary search.
+    size_t first = 0;
+    while (first < times.size()) {
+        year_month_day date{floor<days>(times[first])};
+        size_t last = hourly.lower_bound(sys_days(date) + days(1));
+        size_t n = last - first;
+
+        ColumnSummary temperature = summarize(hourly.temperatures().data() + first, n);
+        ColumnSummary wind = summarize(hourly.wind_speeds().data() + first, n);
+
+        ForecastDay day;
+        day.date = date;
+        day.min_temperature = temperature.min;
+        day.max_temperature = temperature.max;
+        day.avg_wind_speed = wind.sum / n;
+        day.most_common_weather_code = most_common_code(hourly.weather_codes().data() + first, n);
+        days_out.push_back(day);
+
+        first = last;
+    }
+    return days_out;
+}
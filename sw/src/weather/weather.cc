@@ -1,29 +1,33 @@
 #include "weather/weather.h"
+#include "helpers/disk_cache.h"
 #include "helpers/helper.h"
-#include <ctime>
+#include "helpers/metrics.h"
+#include "weather/forecast_parser.h"
+#include <algorithm>
 #include <format>
-#include <iomanip>
 #include <iostream>
-#include <nlohmann/json.hpp>
 #include <sstream>
 #include <string>
 
-using json = nlohmann::json;
+std::shared_ptr<const Forecast> Weather::forecast() const {
+    return current.load();
+}
 
-const std::vector<HourlyForecast>& Weather::get_hourly_forecast() const {
-    return hourly_forecast;
+uint64_t Weather::version() const {
+    return current.version();
 }
 
-const std::vector<ForecastDay>& Weather::get_daily_forecast() const {
-    return daily_forecast;
+std::chrono::steady_clock::time_point Weather::updated_at() const {
+    return current.published_at();
 }
 
 std::string Weather::today_summary() const {
-    if (hourly_forecast.empty()) {
+    auto snapshot = current.load();
+    if (snapshot->hourly.empty()) {
         return "No forecast available.";
     }
 
-    const auto& first = hourly_forecast.front();
+    HourlyForecast first = snapshot->hourly.at(0);
     std::ostringstream oss;
     oss << "Temp: " << first.temperature << "°C, "
         << "Wind: " << first.wind_speed << " m/s, "
@@ -31,145 +35,143 @@ std::string Weather::today_summary() const {
     return oss.str();
 }
 
-void Weather::update_from_json(const std::string& json_data) {
-    try {
-        json j = json::parse(json_data);
-        parse_hourly_json(j);
-        parse_daily_json(j);
-    } catch (const json::parse_error& e) {
-        std::cerr << "Failed to parse weather JSON: " << e.what() << "\n";
+bool Weather::update_from_json(const std::string& json_data) {
+    static Histogram& parse_time = Metrics::global().histogram(
+        "smart_mirror_parse_seconds", "Upstream JSON parse time.", {{"source", "smhi"}});
+
+    Forecast parsed;
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    bool parsed_ok = parse_forecast(json_data, parsed, error);
+    parse_time.record(std::chrono::steady_clock::now() - start);
+    if (!parsed_ok) {
+        std::cerr << "Failed to parse weather JSON: " << error << "\n";
+        return false;
     }
+    current.publish(std::move(parsed));
+    return true;
 }
 
-// refactor later
-
-void Weather::parse_hourly_json(const json& j) {
-    hourly_forecast.clear();
-    for (auto& it : j["timeSeries"]) {
-        HourlyForecast hf;
-        hf.valid_time = it.value("validTime", "");
-        for (auto& ts : it["parameters"]) {
-            std::string name = ts.value("name", "");
-            if (!ts.contains("values") || !ts["values"].is_array() || ts["values"].empty())
-                continue;
-
-            auto& v = ts["values"][0];
-
-            if (name == "t" && v.is_number()) {
-                hf.temperature = v.get<float>();
-            } else if (name == "ws" && v.is_number()) {
-                hf.wind_speed = v.get<float>();
-            } else if (name == "Wsymb2" && v.is_number()) {
-                hf.weather_code = v.get<int>();
-            }
-        }
-        hourly_forecast.push_back(hf);
+// SMHI republishes roughly hourly while the app polls more often. A 304, or a body whose
+// approvedTime matches the forecast already held, leaves the snapshot and its version alone.
+// Returns true when a new forecast was published. A body that does not parse is rejected, so
+// the next poll fetches it in full rather than getting a 304 for it.
+bool Weather::apply_response(const HttpResponse& response) {
+    if (!response.error.empty()) {
+        std::cerr << "Weather fetch failed: " << response.error << "\n";
+        return false;
+    }
+    if (response.not_modified())
+        return false;
+    if (!response.ok()) {
+        std::cerr << "Weather fetch failed: HTTP " << response.status << "\n";
+        return false;
     }
-}
 
-// refactor this later
-void Weather::parse_daily_json(const json& j) {
-    daily_forecast.clear();
-    std::map<std::string, std::vector<HourlyForecast>> daily_map;
+    std::string_view approved = peek_approved_time(response.body);
+    if (!approved.empty() && approved == current.load()->approved_time)
+        return false;
 
-    for (auto& it : j["timeSeries"]) {
-        HourlyForecast hf;
-        hf.valid_time = it.value("validTime", "");
+    if (!update_from_json(response.body)) {
+        response.reject();
+        return false;
+    }
+    return true;
+}
 
-        for (auto& ts : it["parameters"]) {
-            std::string name = ts.value("name", "");
-            if (!ts.contains("values") || !ts["values"].is_array() || ts["values"].empty())
-                continue;
+namespace {
 
-            auto& v = ts["values"][0];
+constexpr uint32_t forecast_cache_format = 3;
 
-            if (name == "t" && v.is_number())
-                hf.temperature = v.get<float>();
-            else if (name == "ws" && v.is_number())
-                hf.wind_speed = v.get<float>();
-            else if (name == "Wsymb2" && v.is_number())
-                hf.weather_code = v.get<int>();
-        }
+} // namespace
 
-        std::string date = hf.valid_time.substr(0, 10);
-        daily_map[date].push_back(hf);
+bool Weather::save(const std::filesystem::path& path) const {
+    auto snapshot = current.load();
+    BinaryWriter out;
+    out.str(snapshot->approved_time);
+    // Only the hourly columns are stored; the daily rows are cheap to aggregate again.
+    const auto& hourly = snapshot->hourly;
+    out.u32(static_cast<uint32_t>(hourly.size()));
+    for (size_t i = 0; i < hourly.size(); ++i) {
+        out.i64(hourly.times()[i].time_since_epoch().count());
+        out.f32(hourly.temperatures()[i]);
+        out.f32(hourly.wind_speeds()[i]);
+        out.u8(hourly.weather_codes()[i]);
     }
+    return save_cache(path, forecast_cache_format, out.data());
+}
 
-    for (auto& [date, hours] : daily_map) {
-        if (hours.empty())
-            continue;
-
-        ForecastDay fd;
-        fd.date = date;
-        float sum_wind = 0.0f;
-        float min_temp = hours.front().temperature;
-        float max_temp = hours.front().temperature;
-        std::map<int, int> weather_count;
-
-        for (auto& h : hours) {
-            min_temp = std::min(min_temp, h.temperature);
-            max_temp = std::max(max_temp, h.temperature);
-            sum_wind += h.wind_speed;
-            weather_count[h.weather_code]++;
-        }
-
-        int common_code = 0;
-        if (!weather_count.empty())
-            common_code =
-                std::max_element(weather_count.begin(), weather_count.end(),
-                                 [](const auto& a, const auto& b) { return a.second < b.second; })
-                    ->first;
-
-        fd.min_temperature = min_temp;
-        fd.max_temperature = max_temp;
-        fd.avg_wind_speed = sum_wind / hours.size();
-        fd.most_common_weather_code = common_code;
-
-        daily_forecast.push_back(fd);
+bool Weather::load(const std::filesystem::path& path) {
+    auto record = load_cache(path, forecast_cache_format);
+    if (!record)
+        return false;
+
+    BinaryReader in(record->payload);
+    Forecast restored;
+    uint32_t count;
+    if (!in.str(restored.approved_time) || !in.u32(count) || count > record->payload.size())
+        return false;
+    restored.hourly.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        HourlyForecast h;
+        int64_t seconds;
+        uint8_t code;
+        if (!in.i64(seconds) || !in.f32(h.temperature) || !in.f32(h.wind_speed) || !in.u8(code))
+            return false;
+        h.valid_time = std::chrono::sys_seconds(std::chrono::seconds(seconds));
+        h.weather_code = code;
+        restored.hourly.push_back(h);
     }
+    if (!in.done())
+        return false;
+    restored.hourly.sort();
+    restored.daily = aggregate_daily(restored.hourly);
+
+    current.publish(std::move(restored));
+    return true;
 }
 
 std::string Weather::perform_curl_request(const std::string& url) {
     return http_get(url);
 }
 
-const HourlyForecast* Weather::get_current_hour(time_t now_utc) const {
-    if (hourly_forecast.empty())
-        return nullptr;
+std::optional<HourlyForecast> Weather::get_current_hour(std::chrono::sys_seconds now) const {
+    auto snapshot = current.load();
+    size_t i = snapshot->hourly.lower_bound(now);
+    if (i == snapshot->hourly.size())
+        return std::nullopt;
+    return snapshot->hourly.at(i);
+}
 
-    for (auto& fore_cast : hourly_forecast) {
-        time_t fore_cast_time =
-            str_to_time_t(fore_cast.valid_time); // <-- str_to_time_t tar valid_time
-        if (fore_cast_time >= now_utc) {
-            return &fore_cast;
-        }
-    }
-    return nullptr;
+std::vector<HourlyForecast> Weather::next_hours(std::chrono::sys_seconds now, size_t n) const {
+    auto snapshot = current.load();
+    auto [first, last] = snapshot->hourly.next(now, n);
+    std::vector<HourlyForecast> hours;
+    hours.reserve(last - first);
+    for (size_t i = first; i < last; ++i)
+        hours.push_back(snapshot->hourly.at(i));
+    return hours;
 }
 
-const ForecastDay* Weather::get_today(const std::string& today_date) const {
-    for (const auto& fd : daily_forecast) {
-        if (fd.date == today_date) {
-            return &fd;
-        }
-    }
-    return nullptr;
+std::optional<ForecastDay> Weather::get_today(std::chrono::year_month_day today) const {
+    auto snapshot = current.load();
+    const auto& daily = snapshot->daily;
+    auto it = std::lower_bound(daily.begin(), daily.end(), today,
+                               [](const ForecastDay& d, const auto& day) { return d.date < day; });
+    if (it == daily.end() || it->date != today)
+        return std::nullopt;
+    return *it;
 }
 
-time_t Weather::str_to_time_t(const std::string& str) const {
-    std::tm tm{};
-    std::istringstream ss(str);
-    ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
-    if (ss.fail()) {
-        return 0;
-    }
-    return timegm(&tm);
+void Weather::set_base_url(std::string url) {
+    base_url = std::move(url);
+}
+
+std::string Weather::forecast_url(double lat, double lon) const {
+    return std::format("{}/api/category/pmp3g/version/2/geotype/point/lon/{}/lat/{}/data.json",
+                       base_url, lon, lat);
 }
 
 std::string Weather::fetch_weather_json(double lat, double lon) {
-    std::string url =
-        std::format("https://opendata-download-metfcst.smhi.se/api/category/pmp3g/version/2/"
-                    "geotype/point/lon/{}/lat/{}/data.json",
-                    lon, lat);
-    return perform_curl_request(url);
+    return perform_curl_request(forecast_url(lat, lon));
 }
@@ -0,0 +1,161 @@
+#include "helpers/iso_time.h"
+#include "http/http_server.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// Stand-in for the SMHI and SL APIs: serves recorded responses on the paths the app
+// requests, with injected latency, jitter, failures and padding, so refreshes, timeouts
+// and the rest of the pipeline can be exercised offline and repeatably. Point the app at it
+// with SMART_MIRROR_SMHI_URL and SMART_MIRROR_SL_URL.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct ReplayOptions {
+    int port = 9090;
+    fs::path fixtures = SMART_MIRROR_FIXTURE_DIR;
+    std::chrono::milliseconds latency{0};
+    std::chrono::milliseconds jitter{0}; // uniform, added to latency
+    double error_rate = 0.0;             // fraction of requests answered 500
+    size_t payload_bytes = 0;            // pad bodies with whitespace up to this size
+    size_t workers = 64;                 // concurrent delayed responses
+    unsigned seed = 1;
+};
+
+void usage() {
+    std::cerr << "usage: smart_mirror_replay [--port N] [--fixtures DIR] [--latency-ms N]\n"
+                 "                           [--jitter-ms N] [--error-rate F] [--payload-bytes N]\n"
+                 "                           [--workers N] [--seed N]\n";
+}
+
+ReplayOptions parse_options(int argc, char** argv) {
+    ReplayOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc)
+            throw std::invalid_argument("missing value for " + flag);
+        std::string value = argv[++i];
+        if (flag == "--port")
+            options.port = std::stoi(value);
+        else if (flag == "--fixtures")
+            options.fixtures = value;
+        else if (flag == "--latency-ms")
+            options.latency = std::chrono::milliseconds(std::stol(value));
+        else if (flag == "--jitter-ms")
+            options.jitter = std::chrono::milliseconds(std::stol(value));
+        else if (flag == "--error-rate")
+            options.error_rate = std::stod(value);
+        else if (flag == "--payload-bytes")
+            options.payload_bytes = std::stoul(value);
+        else if (flag == "--workers")
+            options.workers = std::stoul(value);
+        else if (flag == "--seed")
+            options.seed = static_cast<unsigned>(std::stoul(value));
+        else
+            throw std::invalid_argument("unknown option " + flag);
+    }
+    return options;
+}
+
+std::string read_file(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("cannot read " + path.string());
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// One draw per request from a single seeded generator, so a given seed and request order
+// always produce the same delays and failures.
+class Faults {
+public:
+    explicit Faults(const ReplayOptions& options)
+        : latency(options.latency), jitter(options.jitter), error_rate(options.error_rate),
+          rng(options.seed) {
+    }
+
+    void apply() {
+        std::chrono::milliseconds delay = latency;
+        bool fail;
+        {
+            std::lock_guard lock(mutex);
+            if (jitter.count() > 0)
+                delay += std::chrono::milliseconds(
+                    std::uniform_int_distribution<long>(0, jitter.count())(rng));
+            fail = std::uniform_real_distribution<double>(0.0, 1.0)(rng) < error_rate;
+        }
+        if (delay.count() > 0)
+            std::this_thread::sleep_for(delay);
+        if (fail)
+            throw std::runtime_error("injected failure");
+    }
+
+private:
+    std::chrono::milliseconds latency;
+    std::chrono::milliseconds jitter;
+    double error_rate;
+    std::mutex mutex;
+    std::mt19937 rng;
+};
+
+std::string pad(std::string body, size_t size) {
+    if (body.size() < size)
+        body.append(size - body.size(), ' ');
+    return body;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ReplayOptions options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        usage();
+        return 2;
+    }
+
+    const std::string forecast = pad(read_file(options.fixtures / "smhi_forecast.json"),
+                                     options.payload_bytes);
+    // Trips are recorded with absolute times; they are moved to the present on every
+    // request, so the countdowns look live however old the recording is.
+    const std::string trips = read_file(options.fixtures / "sl_trips.json");
+    constexpr auto trips_recorded_at = parse_iso_datetime("2025-12-20T15:00:00Z").value();
+
+    Faults faults(options);
+    HttpServerOptions server_options;
+    server_options.worker_threads = options.workers;
+    server_options.worker_queue_capacity = options.workers * 16;
+    HttpServer server(options.port, server_options);
+
+    server.add_route("GET",
+                     "/api/category/pmp3g/version/2/geotype/point/lon/{lon}/lat/{lat}/data.json",
+                     [&](const RouteParams&) {
+                         faults.apply();
+                         return std::make_pair(forecast, "application/json");
+                     });
+    server.add_route("GET", "/v2/trips", [&](const RouteParams&) {
+        faults.apply();
+        auto now = std::chrono::floor<std::chrono::minutes>(std::chrono::system_clock::now());
+        return std::make_pair(pad(shift_iso_datetimes(trips, now - trips_recorded_at),
+                                  options.payload_bytes),
+                              "application/json");
+    });
+
+    std::cout << "Replaying " << options.fixtures << ": latency " << options.latency.count()
+              << " ms + up to " << options.jitter.count() << " ms, error rate "
+              << options.error_rate << ", seed " << options.seed << "\n";
+    server.start();
+}